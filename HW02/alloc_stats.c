@@ -0,0 +1,44 @@
+#include "alloc_stats.h"
+#include "counters.h"
+#include <stddef.h>
+
+#ifdef SIM_STATS
+
+/* The linker redirects every malloc/calloc/realloc call in our objects to the
+ * __wrap_ versions below; __real_ reaches the C library. */
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+static unsigned long num_allocations = 0;
+
+
+void* __wrap_malloc(size_t size) {
+  __atomic_add_fetch(&num_allocations, 1, __ATOMIC_RELAXED);
+  return __real_malloc(size);
+}
+
+
+void* __wrap_calloc(size_t count, size_t size) {
+  __atomic_add_fetch(&num_allocations, 1, __ATOMIC_RELAXED);
+  return __real_calloc(count, size);
+}
+
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  __atomic_add_fetch(&num_allocations, 1, __ATOMIC_RELAXED);
+  return __real_realloc(ptr, size);
+}
+
+
+unsigned long get_num_allocations() {
+  return __atomic_load_n(&num_allocations, __ATOMIC_RELAXED);
+}
+
+#else
+
+unsigned long get_num_allocations() {
+  return 0; // a release build links the C library's allocator directly
+}
+
+#endif // SIM_STATS
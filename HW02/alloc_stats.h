@@ -0,0 +1,12 @@
+#ifndef _ALLOC_STATS_H_
+#define _ALLOC_STATS_H_
+
+/* get_num_allocations
+ *   returns the number of malloc/calloc/realloc calls made so far by code
+ *   linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc (see Makefile);
+ *   always 0 in a release build, which neither wraps nor counts them (see
+ *   counters.h)
+ */
+unsigned long get_num_allocations();
+
+#endif /* _ALLOC_STATS_H_ */
@@ -0,0 +1,39 @@
+#ifndef _COUNTERS_H_
+#define _COUNTERS_H_
+
+/* The hot-path counters behind --stats (struct sim_counters in schedsim.h).
+ * They are compiled in unless NDEBUG, so a release build (make RELEASE=1, the
+ * only way the Makefile defines NDEBUG) neither counts nor pays for counting:
+ * COUNT(statement) and the code in #ifdef SIM_STATS blocks disappear with the
+ * asserts. */
+
+#ifndef NDEBUG
+#define SIM_STATS
+#endif
+
+#ifdef SIM_STATS
+#define COUNT(statement) do { statement; } while (0)
+#else
+#define COUNT(statement) do { } while (0)
+#endif
+
+/* samples of something (an insert's depth, a queue's length): how many,
+ * their sum and the largest */
+struct sample_count {
+  unsigned long samples;
+  unsigned long long total;
+  unsigned long max;
+};
+
+static inline void sample_count_add(struct sample_count* count, unsigned long value) {
+  ++count->samples;
+  count->total += value;
+  if (value > count->max)
+    count->max = value;
+}
+
+static inline double sample_count_mean(const struct sample_count* count) {
+  return count->samples ? (double)count->total / count->samples : 0.0;
+}
+
+#endif /* _COUNTERS_H_ */
@@ -0,0 +1,55 @@
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* dumptrace
+ *   prints a binary trace (from --trace=binary) in the simulator's text format,
+ *   so that, for example,
+ *     ./sched_rr --trace=binary test.proc | ./dumptrace
+ *   prints exactly what ./sched_rr test.proc does
+ *
+ *   ./dumptrace [trace.bin]     (reads stdin if no file or "-" is given)
+ */
+
+#define RECORDS_PER_READ 4096
+
+int main(int argc, char** argv) {
+  if (argc > 2) {
+    fprintf(stderr, "Usage: ./dumptrace [trace.bin]\n");
+    return EXIT_FAILURE;
+  }
+  FILE* in = stdin;
+  if (argc == 2 && 0 != strcmp(argv[1], "-")) {
+    in = fopen(argv[1], "rb");
+    if (NULL == in) {
+      perror("ERROR opening trace");
+      return EXIT_FAILURE;
+    }
+  }
+
+  struct trace_header header;
+  if (1 != fread(&header, sizeof(header), 1, in) ||
+      0 != memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic))) {
+    fprintf(stderr, "ERROR: not a binary trace\n");
+    return EXIT_FAILURE;
+  }
+  if (TRACE_VERSION != header.version || sizeof(struct trace_record) != header.record_size) {
+    fprintf(stderr, "ERROR: unsupported trace version %u (record size %u)\n", header.version, header.record_size);
+    return EXIT_FAILURE;
+  }
+
+  static struct trace_record records[RECORDS_PER_READ];
+  size_t count;
+  while (0 < (count = fread(records, sizeof(struct trace_record), RECORDS_PER_READ, in))) {
+    for (size_t i = 0; i < count; ++i)
+      print_trace_record(stdout, &records[i]);
+  }
+  if (ferror(in)) {
+    perror("ERROR reading trace");
+    return EXIT_FAILURE;
+  }
+  if (in != stdin)
+    fclose(in);
+  return EXIT_SUCCESS;
+}
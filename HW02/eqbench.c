@@ -0,0 +1,90 @@
+#include "event_queue.h"
+#include "alloc_stats.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Event queue microbenchmark.
+ *
+ * Drives whichever event queue engine it was linked against with a synthetic
+ * stream that looks like the simulator: every process always has exactly one
+ * pending event, each pop schedules that process's next event a bounded
+ * distance ahead, and some pops also preempt another process (remove_events
+ * followed by a new event).  The stream depends only on the arguments, so the
+ * checksum of the popped (time, pid) sequence must match across engines.
+ *
+ *   make eqbench
+ *   ./eqbench_heap [num_procs] [num_pops] [window] [seed]
+ *
+ * allocs is what the engine allocated during the pops; a release build does
+ * not count allocations (see alloc_stats.h) and always reports 0.
+ */
+
+#ifndef EVENTQ_NAME
+#define EVENTQ_NAME "unknown"
+#endif
+
+static uint64_t rng_state;
+
+static uint64_t next_random() {
+  // xorshift64*
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 2685821657736338717ULL;
+}
+
+
+int main(int argc, char** argv) {
+  unsigned int num_procs = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10000;
+  unsigned long num_pops = (argc > 2) ? strtoul(argv[2], NULL, 10) : 2000000;
+  unsigned int window = (argc > 3) ? strtoul(argv[3], NULL, 10) : 100;
+  rng_state = (argc > 4) ? strtoull(argv[4], NULL, 10) : 111;
+  if (0 == num_procs || 0 == window || 0 == rng_state) {
+    fprintf(stderr, "Usage: %s [num_procs] [num_pops] [window] [seed]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  struct event_queue* queue = event_queue_create();
+  struct process* procs = malloc(num_procs * sizeof(struct process));
+  memset(procs, 0, num_procs * sizeof(struct process));
+  for (unsigned int pid = 0; pid < num_procs; ++pid) {
+    procs[pid].pid = pid;
+    new_event(queue, next_random() % window, ARRIVAL, &procs[pid]);
+  }
+
+  struct timespec start, end;
+  unsigned long start_allocations = get_num_allocations();
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  uint64_t checksum = 0;
+  for (unsigned long i = 0; i < num_pops; ++i) {
+    const struct evt* event = pop_next_event(queue);
+    time_ticks_t now = event->time;
+    struct process* proc = event->proc;
+    checksum = (checksum * 31) ^ ((uint64_t)now << 20) ^ (uint64_t)proc->pid;
+
+    new_event(queue, now + 1 + next_random() % window, FINISH_CPU, proc);
+
+    if (0 == next_random() % 4) {
+      struct process* victim = &procs[next_random() % num_procs];
+      remove_events(queue, victim->pid);
+      new_event(queue, now + next_random() % window, FINISH_TIME_SLICE, victim);
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  unsigned long allocations = get_num_allocations() - start_allocations;
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("engine=%s procs=%u pops=%lu window=%u seconds=%.3f ns_per_pop=%.1f allocs=%lu checksum=%016llx\n",
+         EVENTQ_NAME, num_procs, num_pops, window, seconds, seconds * 1e9 / num_pops,
+         allocations, (unsigned long long)checksum);
+
+  while (NULL != pop_next_event(queue))
+    ;
+  event_queue_destroy(queue);
+  free(procs);
+  return EXIT_SUCCESS;
+}
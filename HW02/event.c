@@ -0,0 +1,10 @@
+#include "event.h"
+#include "process.h"
+#include <stdio.h>
+
+static const char* event_type_strings[] = {"ARRIVAL", "FINISH CPU", "FINISH I/O", "FINISH TIME SLICE"};
+
+
+void print_event(const struct evt* event) {
+  fprintf(stderr, "(t=%d) proc %d %s\n", event->time, event->proc->pid, event_type_strings[event->type]);
+}
@@ -1,17 +1,28 @@
 #ifndef _EVENT_H_
 #define _EVENT_H_
 
-#include "process.h"
+#include "types.h"
+
+struct process;
 
 typedef enum {ARRIVAL, FINISH_CPU, FINISH_IO, FINISH_TIME_SLICE} event_type_t;
+#define NUM_EVENT_TYPES (FINISH_TIME_SLICE + 1)
 
+/* Events live inside struct process (a process has at most one pending event)
+ * and are linked into the event queue in place, so creating one never allocates. */
 struct evt {
   time_ticks_t time;
   event_type_t type;
   struct process* proc;
+
+  // bookkeeping owned by the event queue engine
+  int queued;
+  unsigned long seq;
+  unsigned int queue_index;
+  struct evt* prev;
+  struct evt* next;
 };
 
 void print_event(const struct evt* event);
 
 #endif /* _EVENT_H_ */
-
@@ -1,17 +1,52 @@
 #ifndef _EVENT_QUEUE_H_
 #define _EVENT_QUEUE_H_
 
-#include "event.h"
+#include "process.h"
+#include "counters.h"
 
-struct evt_node {
-  const struct evt* event;
-  struct evt_node* next_event;
+/* The event queue engine is chosen at build time (EVENTQ=heap|wheel|list in
+ * the Makefile); every engine implements this same interface and pops events
+ * in (time, creation order) order, except that an ARRIVAL goes ahead of the
+ * other events at its time (so a simulation that queues arrivals as it goes
+ * sees the same order as one that queued them all up front).
+ *
+ * new_event() links proc->event into the queue; the pointer returned by
+ * pop_next_event() stays valid until the next new_event() on that process.
+ * Each queue is independent, so separate simulations can use separate queues
+ * on separate threads. */
+
+struct event_queue;
+
+struct event_queue* event_queue_create();
+void event_queue_destroy(struct event_queue* queue);
+
+const struct evt* pop_next_event(struct event_queue* queue);
+/* has_event_at
+ *   returns whether an event is queued for time, which must be the time of
+ *   the event pop_next_event() returned last
+ */
+int has_event_at(const struct event_queue* queue, time_ticks_t time);
+void new_event(struct event_queue* queue, time_ticks_t time, event_type_t type, struct process* proc);
+void remove_events(struct event_queue* queue, pid_t pid);
+void print_event_queue(const struct event_queue* queue);
+
+/* event_queue_snapshot
+ *   fills events (with room for one per process) with the queued events in
+ *   the order they would be popped, leaving the queue as it is; returns how
+ *   many there are.  Queueing them again in that order into an empty queue
+ *   reproduces the queue.
+ */
+unsigned int event_queue_snapshot(const struct event_queue* queue, const struct evt** events);
+
+/* What an engine counts when built with SIM_STATS (see counters.h) */
+struct event_queue_stats {
+  struct sample_count insert_depth; // per new_event(): heap levels sifted up, list events passed, wheel level
+  struct sample_count remove_scan;  // per remove_events(): queued events looked at
 };
 
-const struct evt* pop_next_event();
-void new_event(time_ticks_t time, event_type_t type, struct process* proc);
-void remove_events(pid_t pid);
-void print_event_queue();
+/* event_queue_stats
+ *   returns the queue's counters (all zero unless built with SIM_STATS)
+ */
+const struct event_queue_stats* event_queue_stats(const struct event_queue* queue);
 
 #endif /* _EVENT_QUEUE_H_ */
-
@@ -0,0 +1,212 @@
+#include "event_queue.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* The event queue is a binary min-heap ordered by (time, arrival first, seq), so
+ * events at the same time still come out in the order they were created, except
+ * that arrivals come before the rest (which they are anyway when every arrival
+ * is queued up front).  pid_events maps
+ * each pid to its pending event so remove_events() does not scan the heap.
+ * Both arrays only grow while the ARRIVAL events are loaded. */
+struct event_queue {
+  struct evt** heap;
+  unsigned int size;
+  unsigned int capacity;
+  unsigned long next_seq;
+
+  struct evt** pid_events; // array index = pid
+  unsigned int pid_capacity;
+
+  struct event_queue_stats stats;
+};
+
+
+struct event_queue* event_queue_create() {
+  struct event_queue* queue = calloc(1, sizeof(struct event_queue));
+  assert(NULL != queue);
+  return queue;
+}
+
+
+void event_queue_destroy(struct event_queue* queue) {
+  free(queue->heap);
+  free(queue->pid_events);
+  free(queue);
+}
+
+
+static int event_before(const struct evt* a, const struct evt* b) {
+  if (a->time != b->time)
+    return a->time < b->time;
+  if ((ARRIVAL == a->type) != (ARRIVAL == b->type))
+    return ARRIVAL == a->type;
+  return a->seq < b->seq;
+}
+
+
+static void heap_place(struct event_queue* queue, struct evt* event, unsigned int index) {
+  queue->heap[index] = event;
+  event->queue_index = index;
+}
+
+
+static void sift_up(struct event_queue* queue, unsigned int index) {
+  struct evt* event = queue->heap[index];
+  while (index > 0) {
+    unsigned int parent = (index - 1) / 2;
+    if (!event_before(event, queue->heap[parent]))
+      break;
+    heap_place(queue, queue->heap[parent], index);
+    index = parent;
+  }
+  heap_place(queue, event, index);
+}
+
+
+static void sift_down(struct event_queue* queue, unsigned int index) {
+  struct evt* event = queue->heap[index];
+  for (;;) {
+    unsigned int child = 2 * index + 1;
+    if (child >= queue->size)
+      break;
+    if (child + 1 < queue->size && event_before(queue->heap[child + 1], queue->heap[child]))
+      ++child;
+    if (!event_before(queue->heap[child], event))
+      break;
+    heap_place(queue, queue->heap[child], index);
+    index = child;
+  }
+  heap_place(queue, event, index);
+}
+
+
+static void heap_remove(struct event_queue* queue, struct evt* event) {
+  unsigned int index = event->queue_index;
+  assert(index < queue->size && queue->heap[index] == event);
+
+  event->queued = 0;
+  queue->pid_events[event->proc->pid] = NULL;
+  --queue->size;
+  if (index == queue->size)
+    return; // removed the last slot, nothing to fix up
+
+  heap_place(queue, queue->heap[queue->size], index);
+  if (index > 0 && event_before(queue->heap[index], queue->heap[(index - 1) / 2]))
+    sift_up(queue, index);
+  else
+    sift_down(queue, index);
+}
+
+
+const struct evt* pop_next_event(struct event_queue* queue) {
+  if (0 == queue->size)
+    return NULL;
+
+  struct evt* event = queue->heap[0];
+  heap_remove(queue, event);
+  return event;
+}
+
+
+int has_event_at(const struct event_queue* queue, time_ticks_t time) {
+  return 0 != queue->size && time == queue->heap[0]->time;
+}
+
+
+void new_event(struct event_queue* queue, time_ticks_t time, event_type_t type, struct process* proc) {
+  // Make room in the heap and in the per-pid index
+  if (queue->size == queue->capacity) {
+    queue->capacity = (0 == queue->capacity) ? 64 : 2 * queue->capacity;
+    queue->heap = realloc(queue->heap, queue->capacity * sizeof(struct evt*));
+    assert(NULL != queue->heap);
+  }
+  if ((unsigned int)proc->pid >= queue->pid_capacity) {
+    unsigned int new_capacity = (0 == queue->pid_capacity) ? 64 : queue->pid_capacity;
+    while (new_capacity <= (unsigned int)proc->pid)
+      new_capacity *= 2;
+    queue->pid_events = realloc(queue->pid_events, new_capacity * sizeof(struct evt*));
+    assert(NULL != queue->pid_events);
+    memset(&queue->pid_events[queue->pid_capacity], 0, (new_capacity - queue->pid_capacity) * sizeof(struct evt*));
+    queue->pid_capacity = new_capacity;
+  }
+
+  // Fill in the process's event slot
+  struct evt* event = &proc->event;
+  assert(!event->queued); // a process has at most one pending event
+  event->time = time;
+  event->type = type;
+  event->proc = proc;
+  event->seq = queue->next_seq++;
+  event->queued = 1;
+
+#ifdef DEBUG
+  fprintf(stderr, "Creating Event: ");
+  print_event(event);
+#endif // DEBUG
+
+  // Do the actual insert
+  queue->pid_events[proc->pid] = event;
+  heap_place(queue, event, queue->size++);
+  sift_up(queue, event->queue_index);
+
+#ifdef SIM_STATS
+  // the rows it rose: from the bottom one (index size - 1) to where it stopped
+  sample_count_add(&queue->stats.insert_depth, __builtin_clz(event->queue_index + 1) - __builtin_clz(queue->size));
+#endif // SIM_STATS
+}
+
+
+void remove_events(struct event_queue* queue, pid_t pid) {
+  if (pid < 0 || (unsigned int)pid >= queue->pid_capacity || NULL == queue->pid_events[pid]) {
+    COUNT(sample_count_add(&queue->stats.remove_scan, 0));
+    return;
+  }
+  COUNT(sample_count_add(&queue->stats.remove_scan, 1)); // found through pid_events
+
+#ifdef DEBUG
+  fprintf(stderr, "Removing Event: ");
+  print_event(queue->pid_events[pid]);
+#endif // DEBUG
+
+  heap_remove(queue, queue->pid_events[pid]);
+}
+
+
+static int compare_events(const void* a, const void* b) {
+  const struct evt* event_a = *(const struct evt* const*)a;
+  const struct evt* event_b = *(const struct evt* const*)b;
+  if (event_before(event_a, event_b))
+    return -1;
+  return event_before(event_b, event_a);
+}
+
+
+unsigned int event_queue_snapshot(const struct event_queue* queue, const struct evt** events) {
+  // the heap is only partially ordered, so sort a copy
+  if (queue->size > 0)
+    memcpy(events, queue->heap, queue->size * sizeof(struct evt*));
+  qsort(events, queue->size, sizeof(struct evt*), compare_events);
+  return queue->size;
+}
+
+
+void print_event_queue(const struct event_queue* queue) {
+  fprintf(stderr, "\nEVENT QUEUE\n");
+
+  const struct evt** sorted = malloc((queue->size + 1) * sizeof(struct evt*));
+  assert(NULL != sorted);
+  unsigned int num_events = event_queue_snapshot(queue, sorted);
+  for (unsigned int i = 0; i < num_events; ++i) {
+    print_event(sorted[i]);
+  }
+  free(sorted);
+
+  fprintf(stderr, "\n");
+}
+
+
+const struct event_queue_stats* event_queue_stats(const struct event_queue* queue) {
+  return &queue->stats;
+}
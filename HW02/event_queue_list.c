@@ -0,0 +1,143 @@
+#include "event_queue.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* The original sorted singly linked list: O(n) insert and O(n) removal by pid.
+ * Kept as EVENTQ=list for comparison against the other engines. */
+struct event_queue {
+  struct evt* head;
+
+  struct event_queue_stats stats;
+};
+
+
+struct event_queue* event_queue_create() {
+  struct event_queue* queue = calloc(1, sizeof(struct event_queue));
+  assert(NULL != queue);
+  return queue;
+}
+
+
+void event_queue_destroy(struct event_queue* queue) {
+  free(queue);
+}
+
+
+const struct evt* pop_next_event(struct event_queue* queue) {
+  if (NULL == queue->head)
+    return NULL;
+
+  struct evt* event = queue->head;
+  queue->head = queue->head->next;
+  event->queued = 0;
+  return event;
+}
+
+
+int has_event_at(const struct event_queue* queue, time_ticks_t time) {
+  return NULL != queue->head && time == queue->head->time;
+}
+
+
+void new_event(struct event_queue* queue, time_ticks_t time, event_type_t type, struct process* proc) {
+  // Find where to insert the event
+  struct evt* prev = NULL;
+  struct evt* next = queue->head;
+#ifdef SIM_STATS
+  unsigned long passed = 0;
+#endif // SIM_STATS
+
+  // (an arrival goes ahead of the other events at its time)
+  while (NULL != next && (time > next->time || (time == next->time && (ARRIVAL != type || ARRIVAL == next->type)))) {
+    prev = next;
+    next = next->next;
+    COUNT(++passed);
+  }
+  COUNT(sample_count_add(&queue->stats.insert_depth, passed));
+  // INVARIANT: at the end of the list (next == NULL)
+  //   OR prev.time <= event.time <= next.time, with next the first event
+  //   at event.time that event goes before
+  // (both NULL means the queue was empty)
+
+  // Fill in the process's event slot
+  struct evt* event = &proc->event;
+  assert(!event->queued); // a process has at most one pending event
+  event->time = time;
+  event->type = type;
+  event->proc = proc;
+  event->queued = 1;
+  event->next = next;
+
+#ifdef DEBUG
+  fprintf(stderr, "Creating Event: ");
+  print_event(event);
+#endif // DEBUG
+
+  // Do the actual insert
+  if (NULL == prev)
+    queue->head = event; // evt is first! (also handles empty queue)
+  else
+    prev->next = event; // evt is not first
+}
+
+
+void remove_events(struct event_queue* queue, pid_t pid) {
+  struct evt* prev = NULL;
+  struct evt* event = queue->head;
+#ifdef SIM_STATS
+  unsigned long scanned = 0;
+#endif // SIM_STATS
+  while (NULL != event) {
+    COUNT(++scanned);
+    if (pid == event->proc->pid) {
+
+#ifdef DEBUG
+      fprintf(stderr, "Removing Event: ");
+      print_event(event);
+#endif // DEBUG
+
+      if (NULL == prev) {
+        assert(queue->head == event);
+        queue->head = event->next;
+      } else {
+        assert(prev->next == event);
+        prev->next = event->next;
+      }
+      event->queued = 0;
+      event = event->next;
+
+    } else {
+      prev = event;
+      event = event->next;
+    }
+  }
+  COUNT(sample_count_add(&queue->stats.remove_scan, scanned));
+}
+
+
+void print_event_queue(const struct event_queue* queue) {
+  fprintf(stderr, "\nEVENT QUEUE\n");
+
+  for (const struct evt* next_event = queue->head;
+       NULL != next_event;
+       next_event = next_event->next) {
+    print_event(next_event);
+  }
+
+  fprintf(stderr, "\n");
+}
+
+
+unsigned int event_queue_snapshot(const struct event_queue* queue, const struct evt** events) {
+  unsigned int num_events = 0;
+  for (const struct evt* event = queue->head; NULL != event; event = event->next)
+    events[num_events++] = event;
+  return num_events;
+}
+
+
+const struct event_queue_stats* event_queue_stats(const struct event_queue* queue) {
+  return &queue->stats;
+}
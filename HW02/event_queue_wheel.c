@@ -0,0 +1,278 @@
+#include "event_queue.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* Hierarchical timing wheel: 4 levels of 256 slots cover the whole 32-bit
+ * time_ticks_t range.  An event goes into the level of the highest byte in
+ * which its time differs from now (the time of the last popped event),
+ * so level 0 slots each hold exactly one time.  When level 0 runs dry the next
+ * occupied slot of a higher level is cascaded down.  Each slot is a FIFO list
+ * with its arrivals kept in front, and all events with the same time always
+ * share a slot, which keeps the tie-breaking of the other engines.  A bitmap per
+ * level finds the next occupied slot without scanning empty ones. */
+
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1u << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define BITMAP_WORDS (WHEEL_SLOTS / 64)
+
+/* queue_index of a queued event packs its wheel position */
+#define EVENT_LEVEL(event) ((event)->queue_index >> WHEEL_BITS)
+#define EVENT_SLOT(event) ((event)->queue_index & WHEEL_MASK)
+
+struct wheel_slot {
+  struct evt* head;
+  struct evt* tail;
+  struct evt* last_arrival; // the last of the ARRIVAL events at the front, or NULL
+};
+
+struct event_queue {
+  struct wheel_slot wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+  uint64_t occupied[WHEEL_LEVELS][BITMAP_WORDS];
+  time_ticks_t now;
+  unsigned int num_events;
+
+  struct evt** pid_events; // array index = pid
+  unsigned int pid_capacity;
+
+  struct event_queue_stats stats;
+};
+
+
+struct event_queue* event_queue_create() {
+  struct event_queue* queue = calloc(1, sizeof(struct event_queue));
+  assert(NULL != queue);
+  return queue;
+}
+
+
+void event_queue_destroy(struct event_queue* queue) {
+  free(queue->pid_events);
+  free(queue);
+}
+
+
+static void wheel_append(struct event_queue* queue, struct evt* event) {
+  time_ticks_t time = event->time;
+  if (time < queue->now)
+    time = queue->now; // should not happen; run a late event as soon as possible
+
+  unsigned int level = 0;
+  time_ticks_t diff = time ^ queue->now;
+  if (0 != diff)
+    level = (31 - __builtin_clz(diff)) / WHEEL_BITS;
+  unsigned int slot = (time >> (level * WHEEL_BITS)) & WHEEL_MASK;
+
+  struct wheel_slot* list = &queue->wheel[level][slot];
+  event->queue_index = (level << WHEEL_BITS) | slot;
+  // an arrival goes after the slot's other arrivals, anything else at the back
+  struct evt* prev = list->tail;
+  if (ARRIVAL == event->type) {
+    prev = list->last_arrival;
+    list->last_arrival = event;
+  }
+  event->prev = prev;
+  event->next = (NULL == prev) ? list->head : prev->next;
+  if (NULL == prev)
+    list->head = event;
+  else
+    prev->next = event;
+  if (NULL == event->next)
+    list->tail = event;
+  else
+    event->next->prev = event;
+  queue->occupied[level][slot / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+
+static void wheel_unlink(struct event_queue* queue, struct evt* event) {
+  unsigned int level = EVENT_LEVEL(event);
+  unsigned int slot = EVENT_SLOT(event);
+  struct wheel_slot* list = &queue->wheel[level][slot];
+  if (event == list->last_arrival)
+    list->last_arrival = event->prev; // NULL or another arrival
+  if (NULL == event->prev)
+    list->head = event->next;
+  else
+    event->prev->next = event->next;
+  if (NULL == event->next)
+    list->tail = event->prev;
+  else
+    event->next->prev = event->prev;
+  if (NULL == list->head)
+    queue->occupied[level][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+
+  event->queued = 0;
+  queue->pid_events[event->proc->pid] = NULL;
+  --queue->num_events;
+}
+
+
+/* first occupied slot at or after start on this level, or -1 */
+static int next_occupied(const struct event_queue* queue, unsigned int level, unsigned int start) {
+  for (unsigned int word = start / 64; word < BITMAP_WORDS; ++word) {
+    uint64_t bits = queue->occupied[level][word];
+    if (word == start / 64)
+      bits &= ~(uint64_t)0 << (start % 64);
+    if (0 != bits)
+      return word * 64 + __builtin_ctzll(bits);
+  }
+  return -1;
+}
+
+
+const struct evt* pop_next_event(struct event_queue* queue) {
+  if (0 == queue->num_events)
+    return NULL;
+
+  int slot = next_occupied(queue, 0, queue->now & WHEEL_MASK);
+  while (slot < 0) {
+    // level 0 is empty: cascade the next occupied slot of the lowest level that has one
+    unsigned int level = 1;
+    for (; level < WHEEL_LEVELS; ++level) {
+      unsigned int shift = level * WHEEL_BITS;
+      slot = next_occupied(queue, level, ((queue->now >> shift) & WHEEL_MASK) + 1);
+      if (slot >= 0) {
+        time_ticks_t high_bits = (shift + WHEEL_BITS < 32) ? (queue->now >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS) : 0;
+        queue->now = high_bits | ((time_ticks_t)slot << shift);
+        break;
+      }
+    }
+    assert(level < WHEEL_LEVELS);
+
+    struct evt* event = queue->wheel[level][slot].head;
+    queue->wheel[level][slot].head = queue->wheel[level][slot].tail = NULL;
+    queue->wheel[level][slot].last_arrival = NULL;
+    queue->occupied[level][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    while (NULL != event) {
+      struct evt* next = event->next;
+      wheel_append(queue, event); // lands on a lower level, still in order
+      event = next;
+    }
+    slot = next_occupied(queue, 0, queue->now & WHEEL_MASK);
+  }
+
+  struct evt* event = queue->wheel[0][slot].head;
+  queue->now = (queue->now & ~(time_ticks_t)WHEEL_MASK) | slot;
+  wheel_unlink(queue, event);
+  return event;
+}
+
+
+int has_event_at(const struct event_queue* queue, time_ticks_t time) {
+  // the last pop left now at time, whose events are all in one level 0 slot
+  assert(time == queue->now);
+  unsigned int slot = time & WHEEL_MASK;
+  return 0 != (queue->occupied[0][slot / 64] & ((uint64_t)1 << (slot % 64)));
+}
+
+
+void new_event(struct event_queue* queue, time_ticks_t time, event_type_t type, struct process* proc) {
+  if ((unsigned int)proc->pid >= queue->pid_capacity) {
+    unsigned int new_capacity = (0 == queue->pid_capacity) ? 64 : queue->pid_capacity;
+    while (new_capacity <= (unsigned int)proc->pid)
+      new_capacity *= 2;
+    queue->pid_events = realloc(queue->pid_events, new_capacity * sizeof(struct evt*));
+    assert(NULL != queue->pid_events);
+    memset(&queue->pid_events[queue->pid_capacity], 0, (new_capacity - queue->pid_capacity) * sizeof(struct evt*));
+    queue->pid_capacity = new_capacity;
+  }
+
+  // Fill in the process's event slot
+  struct evt* event = &proc->event;
+  assert(!event->queued); // a process has at most one pending event
+  event->time = time;
+  event->type = type;
+  event->proc = proc;
+  event->queued = 1;
+
+#ifdef DEBUG
+  fprintf(stderr, "Creating Event: ");
+  print_event(event);
+#endif // DEBUG
+
+  queue->pid_events[proc->pid] = event;
+  wheel_append(queue, event);
+  ++queue->num_events;
+  COUNT(sample_count_add(&queue->stats.insert_depth, EVENT_LEVEL(event)));
+}
+
+
+void remove_events(struct event_queue* queue, pid_t pid) {
+  if (pid < 0 || (unsigned int)pid >= queue->pid_capacity || NULL == queue->pid_events[pid]) {
+    COUNT(sample_count_add(&queue->stats.remove_scan, 0));
+    return;
+  }
+  COUNT(sample_count_add(&queue->stats.remove_scan, 1)); // found through pid_events
+
+#ifdef DEBUG
+  fprintf(stderr, "Removing Event: ");
+  print_event(queue->pid_events[pid]);
+#endif // DEBUG
+
+  wheel_unlink(queue, queue->pid_events[pid]);
+}
+
+
+void print_event_queue(const struct event_queue* queue) {
+  fprintf(stderr, "\nEVENT QUEUE\n");
+
+  // level 0 comes out in time order; higher levels are only grouped by slot
+  for (unsigned int level = 0; level < WHEEL_LEVELS; ++level) {
+    for (unsigned int slot = 0; slot < WHEEL_SLOTS; ++slot) {
+      for (const struct evt* event = queue->wheel[level][slot].head; NULL != event; event = event->next) {
+        if (level > 0)
+          fprintf(stderr, "  [level %u slot %u] ", level, slot);
+        print_event(event);
+      }
+    }
+  }
+
+  fprintf(stderr, "\n");
+}
+
+
+struct ordered_event {
+  const struct evt* event;
+  unsigned int order; // position in its slot's FIFO, counted across slots
+};
+
+static int compare_ordered_events(const void* a, const void* b) {
+  const struct ordered_event* event_a = a;
+  const struct ordered_event* event_b = b;
+  if (event_a->event->time != event_b->event->time)
+    return (event_a->event->time < event_b->event->time) ? -1 : 1;
+  return (event_a->order < event_b->order) ? -1 : (event_a->order > event_b->order);
+}
+
+
+unsigned int event_queue_snapshot(const struct event_queue* queue, const struct evt** events) {
+  // events with the same time share a slot, so sorting by (time, FIFO
+  // position) gives the pop order
+  struct ordered_event* ordered = malloc((queue->num_events + 1) * sizeof(struct ordered_event));
+  assert(NULL != ordered);
+  unsigned int num_events = 0;
+  for (unsigned int level = 0; level < WHEEL_LEVELS; ++level) {
+    for (unsigned int slot = 0; slot < WHEEL_SLOTS; ++slot) {
+      for (const struct evt* event = queue->wheel[level][slot].head; NULL != event; event = event->next) {
+        ordered[num_events].event = event;
+        ordered[num_events].order = num_events;
+        ++num_events;
+      }
+    }
+  }
+  qsort(ordered, num_events, sizeof(struct ordered_event), compare_ordered_events);
+  for (unsigned int i = 0; i < num_events; ++i)
+    events[i] = ordered[i].event;
+  free(ordered);
+  return num_events;
+}
+
+
+const struct event_queue_stats* event_queue_stats(const struct event_queue* queue) {
+  return &queue->stats;
+}
@@ -0,0 +1,301 @@
+#include "schedsim.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+/* The command line front end: simulates one workload with each --policy in
+ * turn, loading it only once.  The Makefile builds it once per policy, as
+ * sched_<policy>, with that policy as the default.
+ *
+ * --checkpoint-every=N writes <prefix>.<time>.ckpt every N ticks, and
+ * --restore=FILE carries on from one (instead of loading a workload), with
+ * the checkpoint's policy unless --policy gives parameters to change.
+ *
+ * --stream reads an arrival-ordered workload as the simulation goes, once per
+ * policy, instead of loading it (see sim_stream_file()).
+ *
+ * --switch-cost, --cache-penalty and --cache-window set the cost model (see
+ * struct sim_options); its overhead goes to stderr after each run.
+ *
+ * --batch gives the policy the events at each time all at once, through its
+ * events_batch() (see scheduler.h); a policy without one is an error.
+ *
+ * --stats reports the simulator's hot-path counters (see counters.h) to
+ * stderr after each run; a release build does not count them. */
+
+#ifndef DEFAULT_POLICY
+#define DEFAULT_POLICY "rr"
+#endif
+
+#define MAX_POLICIES 32
+
+static void usage() {
+  fprintf(stderr, "Usage: ./simulation [--alloc-stats] [--stats] [--bench] [--metrics] [--batch] [--cpus=N] [--policy=NAME[:KEY=N...][,NAME...]] [--trace=text|binary|none] [--switch-cost=TICKS] [--cache-penalty=TICKS [--cache-window=N]] [--stream | --checkpoint-every=N [--checkpoint-prefix=PREFIX]] filename.proc\n"
+                  "       ./simulation [options] --restore=PREFIX.TIME.ckpt\n");
+}
+
+/* returns a malloc'd copy of a checkpoint's filename without its .<time>.ckpt */
+static char* checkpoint_prefix(const char* filename) {
+  char* prefix = strdup(filename);
+  char* end = strrchr(prefix, '.');
+  if (NULL != end && 0 == strcmp(end, ".ckpt")) {
+    *end = '\0';
+    end = strrchr(prefix, '.');
+    if (NULL != end)
+      *end = '\0';
+  }
+  return prefix;
+}
+
+/* parses a whole unsigned number that fits in 32 bits into value */
+static bool_t parse_u32(const char* arg, unsigned long* value) {
+  char* end;
+  *value = strtoul(arg, &end, 10);
+  return end != arg && '\0' == *end && *value <= 0xffffffffUL;
+}
+
+
+int main(int argc, char** argv) {
+  static const struct option long_options[] = {
+    {"alloc-stats", no_argument, NULL, 'a'},
+    {"stats", no_argument, NULL, 'S'},
+    {"bench", no_argument, NULL, 'b'},
+    {"trace", required_argument, NULL, 't'},
+    {"metrics", no_argument, NULL, 'm'},
+    {"batch", no_argument, NULL, 'B'},
+    {"cpus", required_argument, NULL, 'c'},
+    {"policy", required_argument, NULL, 'p'},
+    {"checkpoint-every", required_argument, NULL, 'k'},
+    {"checkpoint-prefix", required_argument, NULL, 'x'},
+    {"restore", required_argument, NULL, 'r'},
+    {"stream", no_argument, NULL, 's'},
+    {"switch-cost", required_argument, NULL, 'w'},
+    {"cache-penalty", required_argument, NULL, 'e'},
+    {"cache-window", required_argument, NULL, 'n'},
+    {NULL, 0, NULL, 0}
+  };
+  bool_t alloc_stats = FALSE;
+  bool_t report_stats = FALSE;
+  bool_t bench = FALSE;
+  bool_t policy_given = FALSE;
+  bool_t cpus_given = FALSE;
+  bool_t stream = FALSE;
+  const char* restore = NULL;
+  struct sim_options options;
+  sim_default_options(&options);
+  const struct sched_policy* policies[MAX_POLICIES];
+  char* params[MAX_POLICIES];
+  int num_policies = parse_sched_policies(DEFAULT_POLICY, policies, params, MAX_POLICIES);
+
+  int opt;
+  while (-1 != (opt = getopt_long(argc, argv, "", long_options, NULL))) {
+    switch (opt) {
+    case 'a':
+      alloc_stats = TRUE;
+      break;
+    case 'S':
+      report_stats = TRUE;
+      break;
+    case 'b':
+      bench = TRUE;
+      break;
+    case 'm':
+      options.metrics = TRUE;
+      break;
+    case 'B':
+      options.batch_events = TRUE;
+      break;
+    case 'c': {
+      char* end;
+      unsigned long value = strtoul(optarg, &end, 10);
+      if (end == optarg || '\0' != *end || 0 == value || value > SIM_MAX_CPUS) {
+        fprintf(stderr, "ERROR: --cpus must be between 1 and %d\n", SIM_MAX_CPUS);
+        return EXIT_FAILURE;
+      }
+      options.num_cpus = value;
+      cpus_given = TRUE;
+      break;
+    }
+    case 'p':
+      while (num_policies > 0)
+        free(params[--num_policies]);
+      num_policies = parse_sched_policies(optarg, policies, params, MAX_POLICIES);
+      if (num_policies < 0)
+        return EXIT_FAILURE;
+      policy_given = TRUE;
+      break;
+    case 'k': {
+      char* end;
+      unsigned long value = strtoul(optarg, &end, 10);
+      if (end == optarg || '\0' != *end || 0 == value || value > 0xffffffffUL) {
+        fprintf(stderr, "ERROR: --checkpoint-every must be a positive number of ticks\n");
+        return EXIT_FAILURE;
+      }
+      options.checkpoint_every = value;
+      break;
+    }
+    case 'x':
+      options.checkpoint_prefix = optarg;
+      break;
+    case 'r':
+      restore = optarg;
+      break;
+    case 's':
+      stream = TRUE;
+      break;
+    case 'w': {
+      unsigned long value;
+      if (!parse_u32(optarg, &value)) {
+        fprintf(stderr, "ERROR: --switch-cost must be a number of ticks\n");
+        return EXIT_FAILURE;
+      }
+      options.switch_cost = value;
+      break;
+    }
+    case 'e': {
+      unsigned long value;
+      if (!parse_u32(optarg, &value)) {
+        fprintf(stderr, "ERROR: --cache-penalty must be a number of ticks\n");
+        return EXIT_FAILURE;
+      }
+      options.cache_penalty = value;
+      break;
+    }
+    case 'n': {
+      unsigned long value;
+      if (!parse_u32(optarg, &value) || 0 == value) {
+        fprintf(stderr, "ERROR: --cache-window must be a positive number of dispatches\n");
+        return EXIT_FAILURE;
+      }
+      options.cache_window = value;
+      break;
+    }
+    case 't':
+      if (0 == strcmp(optarg, "text")) {
+        options.trace_mode = TRACE_TEXT;
+      } else if (0 == strcmp(optarg, "binary")) {
+        options.trace_mode = TRACE_BINARY;
+      } else if (0 == strcmp(optarg, "none")) {
+        options.trace_mode = TRACE_NONE;
+      } else {
+        usage();
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (NULL == restore && optind >= argc) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  if (stream && (NULL != restore || 0 != options.checkpoint_every)) {
+    fprintf(stderr, "ERROR: --stream cannot be checkpointed or restored\n");
+    return EXIT_FAILURE;
+  }
+
+  char* prefix = NULL;
+  if (NULL != restore) {
+    unsigned int num_cpus;
+    char* restored_params;
+    const struct sched_policy* policy = sim_checkpoint_policy(restore, &restored_params, &num_cpus);
+    if (!policy_given) {
+      while (num_policies > 0)
+        free(params[--num_policies]);
+      policies[0] = policy;
+      params[0] = restored_params;
+      num_policies = 1;
+    } else {
+      free(restored_params);
+    }
+    if (!cpus_given)
+      options.num_cpus = num_cpus;
+    if (num_policies > 1) {
+      fprintf(stderr, "ERROR: --restore takes a single --policy\n");
+      return EXIT_FAILURE;
+    }
+    if (NULL == options.checkpoint_prefix)
+      options.checkpoint_prefix = prefix = checkpoint_prefix(restore);
+  } else if (NULL == options.checkpoint_prefix) {
+    options.checkpoint_prefix = argv[optind];
+  }
+
+  if (num_policies > 1 && TRACE_BINARY == options.trace_mode) {
+    fprintf(stderr, "ERROR: --trace=binary takes a single --policy\n");
+    return EXIT_FAILURE;
+  }
+  struct sim_ctx* contexts[MAX_POLICIES];
+  for (int i = 0; i < num_policies; ++i) {
+    options.policy = policies[i];
+    options.policy_params = params[i];
+    contexts[i] = sim_create(&options);
+    if (NULL == contexts[i])
+      return EXIT_FAILURE;
+  }
+
+  struct timespec start, loaded;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  struct workload workload;
+  if (NULL != restore)
+    sim_restore_file(contexts[0], restore);
+  else if (!stream)
+    load_workload(argv[optind], &workload);
+  clock_gettime(CLOCK_MONOTONIC, &loaded);
+
+  for (int i = 0; i < num_policies; ++i) {
+    struct sim_ctx* ctx = contexts[i];
+    if (num_policies > 1) {
+      printf("policy: %s%s%s\n", policies[i]->name, params[i] ? ":" : "", params[i] ? params[i] : "");
+      if (alloc_stats || report_stats || bench || options.metrics || 0 != options.switch_cost || 0 != options.cache_penalty)
+        fprintf(stderr, "policy: %s%s%s\n", policies[i]->name, params[i] ? ":" : "", params[i] ? params[i] : "");
+    }
+    // every policy but the last runs on a copy, so the loaded workload stays
+    // untouched (a restored or streamed simulation has its own already)
+    if (stream) {
+      sim_stream_file(ctx, argv[optind]);
+    } else if (i + 1 < num_policies) {
+      struct workload copy;
+      copy_workload(&copy, &workload);
+      sim_use_workload(ctx, &copy);
+    } else if (NULL == restore) {
+      sim_use_workload(ctx, &workload);
+    }
+
+    struct sim_stats stats;
+    sim_run(ctx, &stats);
+
+    if (alloc_stats) {
+#ifdef SIM_STATS
+      fprintf(stderr, "allocations: %lu before the event loop, %lu in the event loop\n",
+              stats.setup_allocations, stats.loop_allocations);
+#else
+      fprintf(stderr, "allocations: not counted (built with NDEBUG)\n");
+#endif // SIM_STATS
+    }
+    if (bench)
+      // one machine-readable line for schedbench
+      fprintf(stderr, "bench: procs=%u events=%lu load_seconds=%.6f loop_seconds=%.6f setup_allocations=%lu loop_allocations=%lu\n",
+              stats.num_procs, stats.num_events,
+              (loaded.tv_sec - start.tv_sec) + (loaded.tv_nsec - start.tv_nsec) / 1e9,
+              stats.loop_seconds, stats.setup_allocations, stats.loop_allocations);
+
+    if (report_stats)
+      sim_report_stats(&stats, stderr);
+
+    if (0 != stats.switch_overhead)
+      fprintf(stderr, "switch overhead: %llu ticks, %.2f%% of cpu time\n",
+              stats.switch_overhead, stats.overhead_percent);
+
+    if (options.metrics)
+      sim_report_metrics(ctx, stderr);
+
+    sim_destroy(ctx);
+    free(params[i]);
+  }
+  free(prefix);
+  return EXIT_SUCCESS;
+}
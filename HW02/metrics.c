@@ -0,0 +1,269 @@
+#include "metrics.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*************
+ * Histogram *
+ *************/
+
+/* An HDR-style log-linear histogram: values below 2^SUB_BUCKET_BITS are
+ * counted exactly, larger ones in 2^(SUB_BUCKET_BITS-1) linear steps per power
+ * of two, so every reported value is within 1/64 (about 1.6%) of the truth. */
+#define SUB_BUCKET_BITS 7
+#define SUB_BUCKET_HALF (1U << (SUB_BUCKET_BITS - 1))
+#define NUM_BUCKETS ((64 - SUB_BUCKET_BITS + 2) * SUB_BUCKET_HALF)
+
+struct histogram {
+  unsigned long counts[NUM_BUCKETS];
+  unsigned long total;
+  uint64_t sum;
+  uint64_t max;
+};
+
+static unsigned int histogram_index(uint64_t value) {
+  unsigned int shift = 0;
+  if (value >= (1U << SUB_BUCKET_BITS))
+    shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS + 1;
+  // shift == 0 covers [0, 2^bits) directly; each later shift covers its upper half
+  return shift * SUB_BUCKET_HALF + (unsigned int)(value >> shift);
+}
+
+/* the largest value that shares index's bucket */
+static uint64_t histogram_value(unsigned int index) {
+  if (index < (1U << SUB_BUCKET_BITS))
+    return index;
+  unsigned int shift = index / SUB_BUCKET_HALF - 1;
+  uint64_t sub_bucket = index - shift * SUB_BUCKET_HALF;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+static void histogram_record(struct histogram* histogram, uint64_t value) {
+  ++histogram->counts[histogram_index(value)];
+  ++histogram->total;
+  histogram->sum += value;
+  if (value > histogram->max)
+    histogram->max = value;
+}
+
+static uint64_t histogram_percentile(const struct histogram* histogram, double percentile) {
+  if (0 == histogram->total)
+    return 0;
+  unsigned long rank = (unsigned long)(percentile / 100 * histogram->total + 0.5);
+  if (rank < 1)
+    rank = 1;
+  unsigned long seen = 0;
+  for (unsigned int index = 0; index < NUM_BUCKETS; ++index) {
+    seen += histogram->counts[index];
+    if (seen >= rank)
+      return (histogram_value(index) < histogram->max) ? histogram_value(index) : histogram->max;
+  }
+  return histogram->max;
+}
+
+static double histogram_mean(const struct histogram* histogram) {
+  return histogram->total ? (double)histogram->sum / histogram->total : 0.0;
+}
+
+
+/***********
+ * Metrics *
+ ***********/
+
+struct proc_metrics {
+  time_ticks_t ready_since;   // when it last became READY (valid while waiting)
+  time_ticks_t running_since; // when it last started to run (valid while running)
+  time_ticks_t cpu_time;
+  time_ticks_t waiting_time;
+  unsigned int dispatches;
+  int running;
+};
+
+struct metrics {
+  struct proc_metrics* procs; // array index = pid
+  unsigned int procs_capacity;
+  unsigned int num_procs;
+  unsigned int num_cpus;
+
+  struct histogram turnaround, response, waiting;
+  uint64_t total_cpu_time;
+  unsigned long total_dispatches;
+  unsigned long num_terminated;
+  // Jain's fairness index over x = (cpu share of its lifetime) / tickets
+  double sum_share, sum_x, sum_x_squared;
+};
+
+
+struct metrics* metrics_create(unsigned int num_procs, unsigned int num_cpus) {
+  struct metrics* metrics = calloc(1, sizeof(struct metrics));
+  assert(NULL != metrics);
+  metrics->procs = calloc(num_procs + 1, sizeof(struct proc_metrics));
+  assert(NULL != metrics->procs);
+  metrics->procs_capacity = num_procs + 1;
+  metrics->num_procs = num_procs;
+  metrics->num_cpus = num_cpus;
+  return metrics;
+}
+
+
+void metrics_new_process(struct metrics* metrics, pid_t pid) {
+  if (NULL == metrics)
+    return;
+  if ((unsigned int)pid >= metrics->procs_capacity) {
+    unsigned int new_capacity = metrics->procs_capacity;
+    while (new_capacity <= (unsigned int)pid)
+      new_capacity *= 2;
+    metrics->procs = realloc(metrics->procs, new_capacity * sizeof(struct proc_metrics));
+    assert(NULL != metrics->procs);
+    metrics->procs_capacity = new_capacity;
+  }
+  memset(&metrics->procs[pid], 0, sizeof(struct proc_metrics));
+  ++metrics->num_procs;
+}
+
+
+void metrics_ready(struct metrics* metrics, const struct process* proc, time_ticks_t time) {
+  if (NULL == metrics)
+    return;
+  metrics->procs[proc->pid].ready_since = time;
+}
+
+
+void metrics_switch(struct metrics* metrics, const struct process* from, const struct process* to,
+                    time_ticks_t time, time_ticks_t start) {
+  if (NULL == metrics)
+    return;
+  if (NULL != from) {
+    struct proc_metrics* entry = &metrics->procs[from->pid];
+    if (time >= entry->running_since) {
+      entry->cpu_time += time - entry->running_since;
+      metrics->total_cpu_time += time - entry->running_since;
+    } else {
+      entry->waiting_time -= entry->running_since - time; // switched away before it started
+    }
+    entry->running = 0;
+    if (READY == from->state)
+      entry->ready_since = time; // preempted
+  }
+  if (NULL != to) {
+    struct proc_metrics* entry = &metrics->procs[to->pid];
+    if (0 == entry->dispatches)
+      histogram_record(&metrics->response, start - to->arrival_time);
+    entry->waiting_time += start - entry->ready_since;
+    entry->running_since = start;
+    entry->running = 1;
+    ++entry->dispatches;
+    ++metrics->total_dispatches;
+  }
+}
+
+
+void metrics_terminated(struct metrics* metrics, const struct process* proc, time_ticks_t time) {
+  if (NULL == metrics)
+    return;
+  const struct proc_metrics* entry = &metrics->procs[proc->pid];
+  time_ticks_t lifetime = time - proc->arrival_time;
+  histogram_record(&metrics->turnaround, lifetime);
+  histogram_record(&metrics->waiting, entry->waiting_time);
+  ++metrics->num_terminated;
+
+  // a process usually terminates while still on the CPU; its last run is only
+  // charged when the switch away from it is reported
+  time_ticks_t cpu_time = entry->cpu_time + (entry->running ? time - entry->running_since : 0);
+  double share = (lifetime > 0) ? (double)cpu_time / lifetime : 1;
+  double x = share / (proc->tickets > 0 ? proc->tickets : 1);
+  metrics->sum_share += share;
+  metrics->sum_x += x;
+  metrics->sum_x_squared += x * x;
+}
+
+
+static void print_histogram(FILE* file, const char* name, const struct histogram* histogram) {
+  fprintf(file, "  %-10s %12.1f %10llu %10llu %10llu %10llu\n", name,
+          histogram_mean(histogram),
+          (unsigned long long)histogram_percentile(histogram, 50),
+          (unsigned long long)histogram_percentile(histogram, 99),
+          (unsigned long long)histogram_percentile(histogram, 99.9),
+          (unsigned long long)histogram->max);
+}
+
+
+void metrics_summarize(const struct metrics* metrics, time_ticks_t end_time, struct metrics_summary* summary) {
+  memset(summary, 0, sizeof(struct metrics_summary));
+  summary->fairness = 1.0;
+  if (NULL == metrics)
+    return;
+  summary->num_terminated = metrics->num_terminated;
+  summary->cpu_utilization =
+    end_time ? 100.0 * metrics->total_cpu_time / ((double)end_time * metrics->num_cpus) : 0.0;
+  summary->dispatches = metrics->total_dispatches;
+  summary->turnaround_mean = histogram_mean(&metrics->turnaround);
+  summary->turnaround_p50 = histogram_percentile(&metrics->turnaround, 50);
+  summary->turnaround_p99 = histogram_percentile(&metrics->turnaround, 99);
+  summary->response_mean = histogram_mean(&metrics->response);
+  summary->response_p50 = histogram_percentile(&metrics->response, 50);
+  summary->response_p99 = histogram_percentile(&metrics->response, 99);
+  summary->waiting_mean = histogram_mean(&metrics->waiting);
+  summary->waiting_p50 = histogram_percentile(&metrics->waiting, 50);
+  summary->waiting_p99 = histogram_percentile(&metrics->waiting, 99);
+  if (metrics->num_terminated > 0) {
+    summary->mean_cpu_share = metrics->sum_share / metrics->num_terminated;
+    if (metrics->sum_x_squared > 0)
+      summary->fairness = metrics->sum_x * metrics->sum_x / (metrics->num_terminated * metrics->sum_x_squared);
+  }
+}
+
+
+void metrics_report(const struct metrics* metrics, FILE* file, time_ticks_t end_time) {
+  if (NULL == metrics)
+    return;
+  struct metrics_summary summary;
+  metrics_summarize(metrics, end_time, &summary);
+  fprintf(file, "metrics: %lu of %u processes terminated on %u cpu%s, end time %u\n",
+          metrics->num_terminated, metrics->num_procs, metrics->num_cpus,
+          (1 == metrics->num_cpus) ? "" : "s", end_time);
+  fprintf(file, "  cpu utilization %.2f%%, %lu dispatches (%.2f per process)\n",
+          summary.cpu_utilization, summary.dispatches,
+          metrics->num_procs ? (double)metrics->total_dispatches / metrics->num_procs : 0.0);
+  fprintf(file, "  %-10s %12s %10s %10s %10s %10s\n", "ticks", "mean", "p50", "p99", "p99.9", "max");
+  print_histogram(file, "turnaround", &metrics->turnaround);
+  print_histogram(file, "response", &metrics->response);
+  print_histogram(file, "waiting", &metrics->waiting);
+  if (metrics->num_terminated > 0)
+    fprintf(file, "  mean cpu share %.4f, Jain's fairness index of cpu share per ticket %.4f\n",
+            summary.mean_cpu_share, summary.fairness);
+}
+
+
+void metrics_save(const struct metrics* metrics, FILE* file) {
+  // in native layout, like the rest of a checkpoint; procs is rebuilt on restore
+  fwrite(metrics, sizeof(struct metrics), 1, file);
+  fwrite(metrics->procs, sizeof(struct proc_metrics), metrics->num_procs + 1, file);
+}
+
+
+struct metrics* metrics_restore(FILE* file, unsigned int num_procs) {
+  struct metrics* metrics = malloc(sizeof(struct metrics));
+  assert(NULL != metrics);
+  if (1 != fread(metrics, sizeof(struct metrics), 1, file) || num_procs != metrics->num_procs) {
+    free(metrics);
+    return NULL;
+  }
+  metrics->procs = malloc((metrics->num_procs + 1) * sizeof(struct proc_metrics));
+  assert(NULL != metrics->procs);
+  metrics->procs_capacity = metrics->num_procs + 1;
+  if (metrics->num_procs + 1 != fread(metrics->procs, sizeof(struct proc_metrics), metrics->num_procs + 1, file)) {
+    metrics_destroy(metrics);
+    return NULL;
+  }
+  return metrics;
+}
+
+
+void metrics_destroy(struct metrics* metrics) {
+  if (NULL == metrics)
+    return;
+  free(metrics->procs);
+  free(metrics);
+}
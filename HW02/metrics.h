@@ -0,0 +1,86 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include "process.h"
+#include <stdio.h>
+
+/* Online scheduling metrics (--metrics).
+ *
+ * The simulator reports every state change as it happens; each process keeps
+ * O(1) state, and its turnaround, response (arrival to first run) and waiting
+ * (ready but not running) times go into log-linear histograms when it
+ * terminates.  Each simulation has its own struct metrics; the hooks do
+ * nothing when given NULL, which is how metrics are turned off. */
+
+struct metrics;
+
+/* metrics_create
+ *   starts tracking num_procs processes (pids 0 .. num_procs-1) on num_cpus CPUs
+ */
+struct metrics* metrics_create(unsigned int num_procs, unsigned int num_cpus);
+
+/* metrics_new_process
+ *   starts tracking one more process, as pid, which may have belonged to a
+ *   process that has terminated; for simulations that count their processes
+ *   as they come (metrics_create() with num_procs 0)
+ */
+void metrics_new_process(struct metrics* metrics, pid_t pid);
+
+/* metrics_ready
+ *   proc became READY (arrived or finished I/O) at time
+ */
+void metrics_ready(struct metrics* metrics, const struct process* proc, time_ticks_t time);
+
+/* metrics_switch
+ *   a CPU went from running from to running to at time; either may be NULL.
+ *   to only starts to run at start, after the switch itself (see the cost
+ *   model in schedsim.h), and waits until then.
+ */
+void metrics_switch(struct metrics* metrics, const struct process* from, const struct process* to,
+                    time_ticks_t time, time_ticks_t start);
+
+/* metrics_terminated
+ *   proc terminated at time
+ */
+void metrics_terminated(struct metrics* metrics, const struct process* proc, time_ticks_t time);
+
+/* The aggregates metrics_report() prints, for programs that want the numbers */
+struct metrics_summary {
+  unsigned long num_terminated;
+  double cpu_utilization; // percent of end_time on every CPU
+  unsigned long dispatches;
+  double turnaround_mean, response_mean, waiting_mean;
+  unsigned long long turnaround_p50, turnaround_p99;
+  unsigned long long response_p50, response_p99;
+  unsigned long long waiting_p50, waiting_p99;
+  double mean_cpu_share;
+  double fairness; // Jain's index of cpu share per ticket (1 is perfectly fair)
+};
+
+/* metrics_summarize
+ *   fills in summary for a run that ended at end_time
+ */
+void metrics_summarize(const struct metrics* metrics, time_ticks_t end_time, struct metrics_summary* summary);
+
+/* metrics_report
+ *   prints the aggregates for a run that ended at end_time
+ */
+void metrics_report(const struct metrics* metrics, FILE* file, time_ticks_t end_time);
+
+/* metrics_save
+ *   writes metrics, as they are mid-run, to file (within a checkpoint)
+ */
+void metrics_save(const struct metrics* metrics, FILE* file);
+
+/* metrics_restore
+ *   reads back what metrics_save() wrote for num_procs processes; returns
+ *   NULL if file is truncated or holds metrics for another workload
+ */
+struct metrics* metrics_restore(FILE* file, unsigned int num_procs);
+
+/* metrics_destroy
+ *   releases everything metrics_create() allocated
+ */
+void metrics_destroy(struct metrics* metrics);
+
+#endif /* _METRICS_H_ */
@@ -0,0 +1,124 @@
+#include "schedsim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Every scheduling policy the simulator can run; the first is the default.
+ * Each is defined in its sched_<name>.c. */
+extern const struct sched_policy rr_policy;
+extern const struct sched_policy stcf_policy;
+extern const struct sched_policy stride_policy;
+extern const struct sched_policy mlfq_policy;
+extern const struct sched_policy cfs_policy;
+extern const struct sched_policy lottery_policy;
+
+const struct sched_policy* const sched_policies[] = {
+  &rr_policy,
+  &stcf_policy,
+  &stride_policy,
+  &mlfq_policy,
+  &cfs_policy,
+  &lottery_policy,
+  NULL
+};
+
+
+const struct sched_policy* find_sched_policy(const char* name) {
+  for (unsigned int i = 0; NULL != sched_policies[i]; ++i) {
+    if (0 == strcmp(name, sched_policies[i]->name))
+      return sched_policies[i];
+  }
+  return NULL;
+}
+
+
+/* checks that params is "key=value:key=value" with keys the policy takes and
+ * numeric values */
+static int check_params(const struct sched_policy* policy, const char* params) {
+  for (const char* p = params; ; ++p) {
+    size_t length = strcspn(p, "=:");
+    if ('=' != p[length])
+      return -1;
+    int known = 0;
+    for (unsigned int i = 0; NULL != policy->params && NULL != policy->params[i]; ++i) {
+      if (strlen(policy->params[i]) == length && 0 == strncmp(p, policy->params[i], length))
+        known = 1;
+    }
+    if (!known)
+      return -1;
+    p += length + 1;
+    length = strspn(p, "0123456789");
+    if (0 == length || (':' != p[length] && '\0' != p[length]))
+      return -1;
+    p += length;
+    if ('\0' == *p)
+      return 0;
+  }
+}
+
+
+/* parses one "name[:params]" spec of length characters; returns 0 or -1 */
+static int parse_policy(const char* spec, size_t length, const struct sched_policy** policy, char** params) {
+  size_t name_length = strcspn(spec, ",:");
+  char name[64];
+  if (name_length >= sizeof(name)) {
+    fprintf(stderr, "ERROR: unknown policy \"%.*s\"\n", (int)name_length, spec);
+    return -1;
+  }
+  memcpy(name, spec, name_length);
+  name[name_length] = '\0';
+  *policy = find_sched_policy(name);
+  if (NULL == *policy) {
+    fprintf(stderr, "ERROR: unknown policy \"%s\"; the policies are", name);
+    for (unsigned int i = 0; NULL != sched_policies[i]; ++i)
+      fprintf(stderr, " %s", sched_policies[i]->name);
+    fprintf(stderr, "\n");
+    return -1;
+  }
+
+  *params = NULL;
+  if (name_length == length)
+    return 0;
+  *params = strndup(spec + name_length + 1, length - name_length - 1);
+  if (NULL != *params && 0 == check_params(*policy, *params))
+    return 0;
+  fprintf(stderr, "ERROR: bad parameters for %s \"%.*s\"; it takes", name,
+          (int)(length - name_length - 1), spec + name_length + 1);
+  for (unsigned int i = 0; NULL != (*policy)->params && NULL != (*policy)->params[i]; ++i)
+    fprintf(stderr, " %s=N", (*policy)->params[i]);
+  fprintf(stderr, "%s\n", (NULL == (*policy)->params) ? " none" : "");
+  free(*params);
+  return -1;
+}
+
+
+int parse_sched_policies(const char* list, const struct sched_policy** policies, char** params, int max) {
+  int count = 0;
+  for (const char* p = list; ; ++p) {
+    size_t length = strcspn(p, ",");
+    if (count == max) {
+      fprintf(stderr, "ERROR: more than %d policies in \"%s\"\n", max, list);
+    } else if (0 == parse_policy(p, length, &policies[count], &params[count])) {
+      ++count;
+      p += length;
+      if ('\0' == *p)
+        return count;
+      continue;
+    }
+    while (count > 0)
+      free(params[--count]);
+    return -1;
+  }
+}
+
+
+unsigned long get_policy_param(const char* params, const char* key, unsigned long default_value) {
+  size_t key_length = strlen(key);
+  for (const char* p = params; NULL != p; p = strchr(p, ':')) {
+    if (':' == *p)
+      ++p;
+    if (0 == strncmp(p, key, key_length) && '=' == p[key_length])
+      return strtoul(p + key_length + 1, NULL, 10);
+  }
+  return default_value;
+}
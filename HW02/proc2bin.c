@@ -0,0 +1,27 @@
+#include "workload.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* proc2bin
+ *   converts a text .proc workload into the binary .procb format that the
+ *   simulator can map directly (see workload.h for the layout)
+ *
+ *   ./proc2bin input.proc output.procb
+ */
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: ./proc2bin input.proc output.procb\n");
+    return EXIT_FAILURE;
+  }
+
+  struct workload workload;
+  load_workload(argv[1], &workload);
+  if (-1 == write_workload_binary(&workload, argv[2])) {
+    perror("ERROR writing binary workload");
+    free_workload(&workload);
+    return EXIT_FAILURE;
+  }
+  printf("%s: %u processes, %lu bursts\n", argv[2], workload.num_procs, workload.num_bursts);
+  free_workload(&workload);
+  return EXIT_SUCCESS;
+}
@@ -1,18 +1,12 @@
 #ifndef _PROCESS_H_
 #define _PROCESS_H_
 
-typedef unsigned int time_ticks_t;
-typedef int pid_t;
+#include "types.h"
+#include "event.h"
 
 
 typedef enum {CPU_BURST=0, IO_BURST=1} burst_type_t;
 
-struct burst {
-  burst_type_t type;
-  time_ticks_t remaining_time;
-  struct burst* next_burst;
-};
-
 
 typedef enum {NOT_ARRIVED, READY, BLOCKED, TERMINATED} state_t;
 
@@ -21,9 +15,21 @@ struct process {
   state_t state;
   unsigned int tickets;
   time_ticks_t arrival_time;
-  struct burst* current_burst;
+  time_ticks_t* bursts; // burst lengths, alternating CPU and I/O from a CPU burst;
+                        // the current one counts down as it runs
+  unsigned int num_bursts;
+  unsigned int current_burst; // index into bursts; num_bursts once all are done
+  int cpu; // the CPU it is running on or last ran on, or -1 if it never ran
+  unsigned long last_dispatch; // that CPU's dispatch count when it was dispatched there
+  struct evt event; // the pending ARRIVAL, FINISH_CPU/TIME_SLICE or FINISH_IO event
 };
 
+/* the bursts proc has not finished, and the type and remaining time of its
+ * current one (only when it has some left) */
+#define BURSTS_LEFT(proc) ((proc)->num_bursts - (proc)->current_burst)
+#define BURST_TYPE(proc) (((proc)->current_burst % 2) ? IO_BURST : CPU_BURST)
+#define BURST_TIME(proc) ((proc)->bursts[(proc)->current_burst])
+
 
 void print_process(const struct process* proc);
 
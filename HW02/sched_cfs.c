@@ -0,0 +1,701 @@
+#include "scheduler.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*****************************
+ * Completely Fair Scheduler *
+ *****************************/
+
+/* A CFS-style fair scheduler.  Each process's tickets are its weight; running
+ * for t ticks adds t * VRUNTIME_SCALE / weight to its virtual runtime, and the
+ * ready process with the smallest vruntime runs next.
+ *
+ * Time slices are dynamic: every ready process should get a turn within
+ * latency ticks (stretched to min_granularity per process when there are
+ * many), in proportion to its share of the total weight.
+ *
+ * A process that arrives starts at min_vruntime, the smallest vruntime still
+ * in play.  One that unblocks gets sleeper credit: it is placed up to half of
+ * latency (in its own weighted time) behind min_vruntime, so it runs soon but
+ * cannot bank what it missed while asleep.  Either preempts the running
+ * process if that is more than min_granularity (weighted) ahead of it.
+ *
+ * Parameters (--policy=cfs:latency=N:min_granularity=N), in ticks:
+ *   latency         - default 6 workload time slices
+ *   min_granularity - default 3/4 of a workload time slice
+ */
+
+#define VRUNTIME_SCALE 1000000 // like stride's STRIDE_CONSTANT
+
+/**************************************************************************
+ *
+ *            Red-black tree of ready processes
+ *
+ * Keyed on (vruntime, pid), with the leftmost (next to run) node cached.  The
+ * nodes are an array indexed by pid, linked by pid rather than pointer so the
+ * array can grow with realloc; inserting and erasing are O(log n) and do not
+ * allocate.  The running process is not in the tree.
+ *
+ **************************************************************************/
+typedef struct {
+    const struct process* proc;
+    pid_t parent;
+    pid_t left;
+    pid_t right;
+    bool_t red;
+    bool_t queued; // in the tree
+    unsigned int weight;
+    uint64_t vruntime;
+} Entity;
+
+typedef struct {
+    Entity* entities; // array index = pid
+    unsigned int num_entities;
+    pid_t root;
+    pid_t leftmost;
+    unsigned int num_queued;
+    uint64_t queued_weight;
+
+    uint64_t min_vruntime;
+    time_ticks_t exec_start; // when the running process was last charged
+    time_ticks_t latency;
+    time_ticks_t min_granularity;
+
+    // during cfs_events_batch(): the process the callbacks so far would have
+    // left running, and whether the one playing now switched
+    bool_t batching;
+    pid_t batch_current;
+    bool_t batch_switched;
+} CFS; // the policy state, one per simulation
+
+static Entity* get_entity(CFS* cfs, const struct process* proc) {
+    if ((unsigned int)proc->pid >= cfs->num_entities) {
+        unsigned int new_size = (cfs->num_entities == 0) ? 64 : cfs->num_entities;
+        while (new_size <= (unsigned int)proc->pid) {
+            new_size *= 2;
+        }
+        cfs->entities = realloc(cfs->entities, new_size * sizeof(Entity));
+        assert(cfs->entities != NULL);
+        memset(&cfs->entities[cfs->num_entities], 0, (new_size - cfs->num_entities) * sizeof(Entity));
+        cfs->num_entities = new_size;
+    }
+    Entity* entity = &cfs->entities[proc->pid];
+    entity->proc = proc;
+    return entity;
+}
+
+static int rb_before(CFS* cfs, pid_t a, pid_t b) {
+    if (cfs->entities[a].vruntime != cfs->entities[b].vruntime) {
+        return cfs->entities[a].vruntime < cfs->entities[b].vruntime;
+    }
+    return a < b;
+}
+static int rb_red(CFS* cfs, pid_t pid) {
+    return pid != -1 && cfs->entities[pid].red;
+}
+/* makes new_child take old_child's place under parent */
+static void rb_replace_child(CFS* cfs, pid_t parent, pid_t old_child, pid_t new_child) {
+    if (parent == -1) {
+        cfs->root = new_child;
+    } else if (cfs->entities[parent].left == old_child) {
+        cfs->entities[parent].left = new_child;
+    } else {
+        cfs->entities[parent].right = new_child;
+    }
+    if (new_child != -1) {
+        cfs->entities[new_child].parent = parent;
+    }
+}
+static void rb_rotate_left(CFS* cfs, pid_t x) {
+    Entity* e = cfs->entities;
+    pid_t y = e[x].right;
+    e[x].right = e[y].left;
+    if (e[y].left != -1) {
+        e[e[y].left].parent = x;
+    }
+    rb_replace_child(cfs, e[x].parent, x, y);
+    e[y].left = x;
+    e[x].parent = y;
+}
+static void rb_rotate_right(CFS* cfs, pid_t x) {
+    Entity* e = cfs->entities;
+    pid_t y = e[x].left;
+    e[x].left = e[y].right;
+    if (e[y].right != -1) {
+        e[e[y].right].parent = x;
+    }
+    rb_replace_child(cfs, e[x].parent, x, y);
+    e[y].right = x;
+    e[x].parent = y;
+}
+
+static void rb_insert(CFS* cfs, Entity* entity) {
+    Entity* e = cfs->entities;
+    pid_t pid = entity->proc->pid;
+    assert(!entity->queued);
+
+    pid_t parent = -1;
+    int leftmost = 1;
+    for (pid_t node = cfs->root; node != -1; ) {
+        parent = node;
+        if (rb_before(cfs, pid, node)) {
+            node = e[node].left;
+        } else {
+            node = e[node].right;
+            leftmost = 0;
+        }
+    }
+    entity->parent = parent;
+    entity->left = entity->right = -1;
+    entity->red = TRUE;
+    entity->queued = TRUE;
+    if (parent == -1) {
+        cfs->root = pid;
+    } else if (rb_before(cfs, pid, parent)) {
+        e[parent].left = pid;
+    } else {
+        e[parent].right = pid;
+    }
+    if (leftmost) {
+        cfs->leftmost = pid;
+    }
+    ++cfs->num_queued;
+    cfs->queued_weight += entity->weight;
+
+    // a red parent is never the root, so it always has a grandparent
+    pid_t node = pid;
+    while (rb_red(cfs, e[node].parent)) {
+        pid_t p = e[node].parent;
+        pid_t g = e[p].parent;
+        if (p == e[g].left) {
+            pid_t uncle = e[g].right;
+            if (rb_red(cfs, uncle)) {
+                e[p].red = e[uncle].red = FALSE;
+                e[g].red = TRUE;
+                node = g;
+                continue;
+            }
+            if (node == e[p].right) {
+                rb_rotate_left(cfs, p);
+                node = p;
+                p = e[node].parent;
+            }
+            e[p].red = FALSE;
+            e[g].red = TRUE;
+            rb_rotate_right(cfs, g);
+        } else {
+            pid_t uncle = e[g].left;
+            if (rb_red(cfs, uncle)) {
+                e[p].red = e[uncle].red = FALSE;
+                e[g].red = TRUE;
+                node = g;
+                continue;
+            }
+            if (node == e[p].left) {
+                rb_rotate_right(cfs, p);
+                node = p;
+                p = e[node].parent;
+            }
+            e[p].red = FALSE;
+            e[g].red = TRUE;
+            rb_rotate_left(cfs, g);
+        }
+    }
+    e[cfs->root].red = FALSE;
+}
+
+static void rb_erase(CFS* cfs, Entity* entity) {
+    Entity* e = cfs->entities;
+    pid_t pid = entity->proc->pid;
+    assert(entity->queued);
+    entity->queued = FALSE;
+    --cfs->num_queued;
+    cfs->queued_weight -= entity->weight;
+
+    if (cfs->leftmost == pid) {
+        // the leftmost node has no left child: its successor is the smallest
+        // of its right subtree, or else its parent
+        pid_t next = entity->right;
+        if (next != -1) {
+            while (e[next].left != -1) {
+                next = e[next].left;
+            }
+        } else {
+            next = entity->parent;
+        }
+        cfs->leftmost = next;
+    }
+
+    // x (possibly -1) moves into the place of the node actually removed
+    pid_t x, x_parent;
+    bool_t removed_red = entity->red;
+    if (entity->left == -1) {
+        x = entity->right;
+        x_parent = entity->parent;
+        rb_replace_child(cfs, entity->parent, pid, x);
+    } else if (entity->right == -1) {
+        x = entity->left;
+        x_parent = entity->parent;
+        rb_replace_child(cfs, entity->parent, pid, x);
+    } else {
+        // swap in the successor y, the smallest of the right subtree
+        pid_t y = entity->right;
+        while (e[y].left != -1) {
+            y = e[y].left;
+        }
+        removed_red = e[y].red;
+        x = e[y].right;
+        if (e[y].parent == pid) {
+            x_parent = y;
+        } else {
+            x_parent = e[y].parent;
+            rb_replace_child(cfs, e[y].parent, y, x);
+            e[y].right = entity->right;
+            e[e[y].right].parent = y;
+        }
+        rb_replace_child(cfs, entity->parent, pid, y);
+        e[y].left = entity->left;
+        e[e[y].left].parent = y;
+        e[y].red = entity->red;
+    }
+    if (removed_red) {
+        return;
+    }
+
+    // x carries an extra black: push it up or absorb it with rotations
+    while (x != cfs->root && !rb_red(cfs, x)) {
+        if (x == e[x_parent].left) {
+            pid_t w = e[x_parent].right;
+            if (e[w].red) {
+                e[w].red = FALSE;
+                e[x_parent].red = TRUE;
+                rb_rotate_left(cfs, x_parent);
+                w = e[x_parent].right;
+            }
+            if (!rb_red(cfs, e[w].left) && !rb_red(cfs, e[w].right)) {
+                e[w].red = TRUE;
+                x = x_parent;
+                x_parent = e[x].parent;
+                continue;
+            }
+            if (!rb_red(cfs, e[w].right)) {
+                e[e[w].left].red = FALSE;
+                e[w].red = TRUE;
+                rb_rotate_right(cfs, w);
+                w = e[x_parent].right;
+            }
+            e[w].red = e[x_parent].red;
+            e[x_parent].red = FALSE;
+            e[e[w].right].red = FALSE;
+            rb_rotate_left(cfs, x_parent);
+        } else {
+            pid_t w = e[x_parent].left;
+            if (e[w].red) {
+                e[w].red = FALSE;
+                e[x_parent].red = TRUE;
+                rb_rotate_right(cfs, x_parent);
+                w = e[x_parent].left;
+            }
+            if (!rb_red(cfs, e[w].left) && !rb_red(cfs, e[w].right)) {
+                e[w].red = TRUE;
+                x = x_parent;
+                x_parent = e[x].parent;
+                continue;
+            }
+            if (!rb_red(cfs, e[w].left)) {
+                e[e[w].right].red = FALSE;
+                e[w].red = TRUE;
+                rb_rotate_left(cfs, w);
+                w = e[x_parent].left;
+            }
+            e[w].red = e[x_parent].red;
+            e[x_parent].red = FALSE;
+            e[e[w].left].red = FALSE;
+            rb_rotate_right(cfs, x_parent);
+        }
+        x = cfs->root;
+    }
+    if (x != -1) {
+        e[x].red = FALSE;
+    }
+}
+
+/*************************************************************************
+ *
+ *                  CFS Scheduler Implementation
+ *
+ * ************************************************************************/
+
+/* the running process, as the callbacks see it: during a batch, the one the
+ * callbacks so far would have left running */
+static pid_t current_proc(CFS* cfs) {
+    return cfs->batching ? cfs->batch_current : get_current_proc();
+}
+
+/* context_switch(), or during a batch, notes that the callback would have
+ * (the simulator still hears of a process that is not READY, to refuse it as
+ * it would have) */
+static void switch_to(CFS* cfs, pid_t pid) {
+    if (!cfs->batching || get_process(pid)->state != READY) {
+        context_switch(pid);
+        return;
+    }
+    cfs->batch_current = pid;
+    cfs->batch_switched = TRUE;
+}
+
+/* converts ticks of real time into an entity's virtual time */
+static uint64_t to_vruntime(const Entity* entity, time_ticks_t ticks) {
+    return (uint64_t)ticks * VRUNTIME_SCALE / entity->weight;
+}
+
+/* charges the running process for the time since it was last charged and
+ * moves min_vruntime up to the smallest vruntime still in play */
+static void update_curr(CFS* cfs) {
+    time_ticks_t now = get_current_time();
+    pid_t current = current_proc(cfs);
+    uint64_t smallest = UINT64_MAX;
+    if (current != -1) {
+        Entity* entity = &cfs->entities[current];
+        entity->vruntime += to_vruntime(entity, now - cfs->exec_start);
+        smallest = entity->vruntime;
+    }
+    cfs->exec_start = now;
+    if (cfs->leftmost != -1 && cfs->entities[cfs->leftmost].vruntime < smallest) {
+        smallest = cfs->entities[cfs->leftmost].vruntime;
+    }
+    if (smallest != UINT64_MAX && smallest > cfs->min_vruntime) {
+        cfs->min_vruntime = smallest;
+    }
+}
+
+/* takes the leftmost process out of the tree and runs it for its share of
+ * the scheduling period (which may mean keeping the current one running) */
+static void run_next(CFS* cfs) {
+    if (cfs->leftmost == -1) {
+        return;
+    }
+    Entity* entity = &cfs->entities[cfs->leftmost];
+    rb_erase(cfs, entity);
+
+    uint64_t num_ready = cfs->num_queued + 1;
+    uint64_t period = cfs->latency;
+    if (num_ready * cfs->min_granularity > period) {
+        period = num_ready * cfs->min_granularity;
+    }
+    uint64_t slice = period * entity->weight / (cfs->queued_weight + entity->weight);
+    set_time_slice((slice > 0) ? slice : 1);
+
+    cfs->exec_start = get_current_time();
+    if (entity->proc->pid != current_proc(cfs)) {
+        switch_to(cfs, entity->proc->pid);
+    }
+}
+
+/* queues a process that became ready; runs it (or whatever is now leftmost)
+ * if the CPU is free or the running process is far enough ahead of it */
+static void enqueue_ready(CFS* cfs, Entity* entity) {
+    rb_insert(cfs, entity);
+    pid_t current = current_proc(cfs);
+    if (current == -1) {
+        run_next(cfs);
+        return;
+    }
+    Entity* running = &cfs->entities[current];
+    if (READY != running->proc->state) {
+        // its burst just ended; its blocked() / terminated() will pick the next one
+        return;
+    }
+    if (running->vruntime > entity->vruntime + to_vruntime(entity, cfs->min_granularity)) {
+        rb_insert(cfs, running);
+        run_next(cfs);
+    }
+}
+
+
+/* cfs_init
+ *   will be called exactly once before any processes arrive or any other events
+ */
+static CFS* create_cfs(const char* params, time_ticks_t latency, time_ticks_t min_granularity) {
+    CFS* cfs = calloc(1, sizeof(CFS));
+    assert(cfs != NULL);
+    cfs->root = cfs->leftmost = -1;
+    cfs->latency = get_policy_param(params, "latency", latency);
+    cfs->min_granularity = get_policy_param(params, "min_granularity", min_granularity);
+    if (cfs->latency == 0) {
+        cfs->latency = 1;
+    }
+    return cfs;
+}
+
+static void* cfs_init(const char* params) {
+    use_time_slice(TRUE);
+    time_ticks_t unit = (get_time_slice() > 0) ? get_time_slice() : 1;
+    return create_cfs(params, 6 * unit, (3 * unit + 3) / 4);
+}
+
+
+/* cfs_new_process
+ *   will be called when a new process arrives (i.e., fork())
+ *
+ * proc - the new process that just arrived
+ */
+static void cfs_new_process(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    CFS* cfs = state;
+
+    update_curr(cfs);
+    Entity* entity = get_entity(cfs, proc);
+    entity->weight = (proc->tickets > 0) ? proc->tickets : 1;
+    entity->vruntime = cfs->min_vruntime;
+    enqueue_ready(cfs, entity);
+}
+
+
+/* cfs_finished_time_slice
+ *   will be called when the running process finished a time slice
+ *
+ * proc - the process whose time slice just ended
+ */
+static void cfs_finished_time_slice(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    CFS* cfs = state;
+
+    update_curr(cfs);
+    rb_insert(cfs, &cfs->entities[proc->pid]);
+    run_next(cfs);
+}
+
+
+/* cfs_blocked
+ *   will be called when the running process blocks
+ *
+ * proc - the process that just blocked
+ */
+static void cfs_blocked(void* state, int cpu, const struct process* proc) {
+    assert(BLOCKED == proc->state);
+    (void)cpu; // single CPU
+    CFS* cfs = state;
+
+    update_curr(cfs);
+    pid_t current = current_proc(cfs);
+    if (current == -1 || current == proc->pid) {
+        run_next(cfs);
+    }
+}
+
+
+/* cfs_unblocked
+ *   will be called when a blocked process unblocks
+ *
+ * proc - the process that just unblocked
+ */
+static void cfs_unblocked(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    CFS* cfs = state;
+
+    update_curr(cfs);
+    Entity* entity = &cfs->entities[proc->pid];
+    uint64_t credit = to_vruntime(entity, cfs->latency / 2);
+    uint64_t lowest = (cfs->min_vruntime > credit) ? cfs->min_vruntime - credit : 0;
+    if (entity->vruntime < lowest) {
+        entity->vruntime = lowest;
+    }
+    enqueue_ready(cfs, entity);
+}
+
+
+/* cfs_terminated
+ *   will be called when the running process terminates
+ *
+ * proc - the process that just terminated
+ */
+static void cfs_terminated(void* state, int cpu, const struct process* proc) {
+    assert(TERMINATED == proc->state);
+    (void)cpu; // single CPU
+    CFS* cfs = state;
+
+    update_curr(cfs);
+    pid_t current = current_proc(cfs);
+    if (current == -1 || current == proc->pid) {
+        run_next(cfs);
+    }
+}
+
+
+/* cfs_events_batch
+ *   will be called instead of the callbacks above with every event at the
+ *   current time, when the simulation batches events
+ *
+ * events - the events, in the order the callbacks would have been called;
+ *          each gets CPU 0 if its callback would have switched
+ *
+ * Note: the callbacks play the events through against what they would have
+ *       left running by then; only the last switch actually happens (a
+ *       process switched away from and back to starts over, as it would have),
+ *       with the time slice run_next() gave it then
+ */
+static void cfs_events_batch(void* state, struct sched_event* events, unsigned int num_events) {
+    CFS* cfs = state;
+    pid_t running = get_current_proc();
+    bool_t switched = FALSE;
+    bool_t sliced = FALSE;
+    time_ticks_t slice = 0;
+    cfs->batch_current = running;
+    cfs->batching = TRUE;
+    for (unsigned int i = 0; i < num_events; ++i) {
+        if (events[i].type == SCHED_FINISHED_TIME_SLICE && events[i].proc->pid != cfs->batch_current) {
+            continue; // preempted earlier in the batch, which would have dropped this event
+        }
+        cfs->batch_switched = FALSE;
+        switch (events[i].type) {
+        case SCHED_NEW_PROCESS:
+            cfs_new_process(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_FINISHED_TIME_SLICE:
+            cfs_finished_time_slice(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_BLOCKED:
+            cfs_blocked(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_UNBLOCKED:
+            cfs_unblocked(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_TERMINATED:
+            cfs_terminated(state, events[i].cpu, events[i].proc);
+            break;
+        }
+        if (cfs->batch_switched) {
+            events[i].switched = 0;
+            switched = TRUE;
+        }
+        // the slice the process left running got, by a switch or by going on
+        // after its time slice (later run_next()s that keep it change neither)
+        if (cfs->batch_switched ||
+            (events[i].type == SCHED_FINISHED_TIME_SLICE && events[i].proc->pid == cfs->batch_current)) {
+            sliced = TRUE;
+            slice = get_time_slice();
+        }
+        pid_t current = cfs->batch_current;
+        if (events[i].idles_stopped && current != -1 && get_process(current)->state != READY) {
+            cfs->batch_current = -1;
+        }
+    }
+    cfs->batching = FALSE;
+
+    if (sliced) {
+        set_time_slice(slice);
+    }
+    pid_t current = cfs->batch_current;
+    if (current != -1 && switched) {
+        if (current == running) {
+            context_switch_idle(0);
+        }
+        context_switch(current);
+    }
+}
+
+
+/* cfs_cleanup
+ *   will be called exactly once after all processes have terminated and there
+ *   are no more events left to occur
+ */
+static void cfs_cleanup(void* state) {
+    CFS* cfs = state;
+    free(cfs->entities);
+    free(cfs);
+}
+
+
+/* cfs_save
+ *   writes the parameters, min_vruntime and every known process's weight and
+ *   vruntime
+ */
+static void cfs_save(void* state, FILE* file) {
+    CFS* cfs = state;
+    fwrite(&cfs->latency, sizeof(time_ticks_t), 1, file);
+    fwrite(&cfs->min_granularity, sizeof(time_ticks_t), 1, file);
+    fwrite(&cfs->exec_start, sizeof(time_ticks_t), 1, file);
+    fwrite(&cfs->min_vruntime, sizeof(uint64_t), 1, file);
+
+    unsigned int num_known = 0;
+    for (unsigned int pid = 0; pid < cfs->num_entities; ++pid) {
+        num_known += (cfs->entities[pid].proc != NULL);
+    }
+    fwrite(&num_known, sizeof(num_known), 1, file);
+    for (pid_t pid = 0; (unsigned int)pid < cfs->num_entities; ++pid) {
+        const Entity* entity = &cfs->entities[pid];
+        if (entity->proc != NULL) {
+            fwrite(&pid, sizeof(pid), 1, file);
+            fwrite(&entity->weight, sizeof(unsigned int), 1, file);
+            fwrite(&entity->vruntime, sizeof(uint64_t), 1, file);
+            fwrite(&entity->queued, sizeof(bool_t), 1, file);
+        }
+    }
+}
+
+
+/* cfs_restore
+ *   rebuilds what cfs_save() wrote; parameters given now replace the saved
+ *   ones.  The tree is rebuilt by inserting, which keeps its order (all that
+ *   picking depends on) if not its shape.
+ */
+static void* cfs_restore(const char* params, FILE* file) {
+    time_ticks_t latency, min_granularity;
+    if (fread(&latency, sizeof(latency), 1, file) != 1 || fread(&min_granularity, sizeof(min_granularity), 1, file) != 1) {
+        return NULL;
+    }
+    CFS* cfs = create_cfs(params, latency, min_granularity);
+    unsigned int num_known;
+    int ok = (fread(&cfs->exec_start, sizeof(time_ticks_t), 1, file) == 1 &&
+              fread(&cfs->min_vruntime, sizeof(uint64_t), 1, file) == 1 &&
+              fread(&num_known, sizeof(num_known), 1, file) == 1);
+    for (unsigned int i = 0; ok && i < num_known; ++i) {
+        pid_t pid;
+        unsigned int weight;
+        uint64_t vruntime;
+        bool_t queued;
+        ok = (fread(&pid, sizeof(pid), 1, file) == 1 && fread(&weight, sizeof(weight), 1, file) == 1 &&
+              fread(&vruntime, sizeof(vruntime), 1, file) == 1 && fread(&queued, sizeof(queued), 1, file) == 1 &&
+              get_process(pid) != NULL && weight > 0);
+        if (ok) {
+            Entity* entity = get_entity(cfs, get_process(pid));
+            ok = (entity->weight == 0); // each process once
+            entity->weight = weight;
+            entity->vruntime = vruntime;
+            if (ok && queued) {
+                rb_insert(cfs, entity);
+            }
+        }
+    }
+    if (!ok) {
+        cfs_cleanup(cfs);
+        return NULL;
+    }
+    return cfs;
+}
+
+
+static const char* const cfs_params[] = {"latency", "min_granularity", NULL};
+
+const struct sched_policy cfs_policy = {
+    .name = "cfs",
+    .multi_cpu = FALSE,
+    .params = cfs_params,
+    .init = cfs_init,
+    .new_process = cfs_new_process,
+    .finished_time_slice = cfs_finished_time_slice,
+    .blocked = cfs_blocked,
+    .unblocked = cfs_unblocked,
+    .terminated = cfs_terminated,
+    .cleanup = cfs_cleanup,
+    .save = cfs_save,
+    .restore = cfs_restore,
+    .events_batch = cfs_events_batch,
+};
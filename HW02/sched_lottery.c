@@ -0,0 +1,309 @@
+#include "scheduler.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************
+ * Lottery Scheduler *
+ *********************/
+
+/* At the end of every time slice (and whenever the CPU is free) one of the
+ * ready processes' tickets is drawn at random, and its process runs next, so
+ * each ready process wins in proportion to its tickets.  The running process
+ * takes part in the draw, and is not preempted by arrivals in between.
+ *
+ * Draws come from a per-simulation xorshift64* generator, so runs are
+ * reproducible; --policy=lottery:seed=N picks another sequence (default 1).
+ */
+
+/**************************************************************************
+ *
+ *            Fenwick tree over the ready processes' tickets
+ *
+ * Indexed by pid; a process holds its tickets while READY and 0 otherwise.
+ * Changing a process's tickets and finding the holder of the r-th ticket are
+ * both O(log n), instead of a walk over the ready set.  The capacity is a
+ * power of two, so the search can descend one bit at a time.
+ *
+ **************************************************************************/
+typedef struct {
+    const struct process** procs; // array index = pid
+    unsigned int* tickets;        // what each pid holds in the tree
+    uint64_t* tree;               // tree[i] sums tickets (i - (i & -i), i] (1-based)
+    unsigned int capacity;
+    uint64_t total;
+
+    uint64_t random; // xorshift64* state, never 0
+} Lottery; // the policy state, one per simulation
+
+static void fenwick_add(Lottery* lottery, unsigned int pid, int64_t delta) {
+    for (unsigned int i = pid + 1; i <= lottery->capacity; i += i & -i) {
+        lottery->tree[i] += delta;
+    }
+    lottery->total += delta;
+}
+
+/* grows the arrays to hold pid and rebuilds the tree in O(capacity) */
+static void fenwick_grow(Lottery* lottery, unsigned int pid) {
+    unsigned int old_capacity = lottery->capacity;
+    unsigned int new_capacity = (old_capacity == 0) ? 64 : old_capacity;
+    while (new_capacity <= pid) {
+        new_capacity *= 2;
+    }
+    lottery->procs = realloc(lottery->procs, new_capacity * sizeof(const struct process*));
+    lottery->tickets = realloc(lottery->tickets, new_capacity * sizeof(unsigned int));
+    lottery->tree = realloc(lottery->tree, (new_capacity + 1) * sizeof(uint64_t));
+    assert(lottery->procs != NULL && lottery->tickets != NULL && lottery->tree != NULL);
+    memset(&lottery->procs[old_capacity], 0, (new_capacity - old_capacity) * sizeof(const struct process*));
+    memset(&lottery->tickets[old_capacity], 0, (new_capacity - old_capacity) * sizeof(unsigned int));
+    lottery->capacity = new_capacity;
+
+    memset(lottery->tree, 0, (new_capacity + 1) * sizeof(uint64_t));
+    for (unsigned int i = 1; i <= new_capacity; ++i) {
+        lottery->tree[i] += lottery->tickets[i - 1];
+        unsigned int parent = i + (i & -i);
+        if (parent <= new_capacity) {
+            lottery->tree[parent] += lottery->tree[i];
+        }
+    }
+}
+
+/* sets how many tickets pid holds in the draw */
+static void set_tickets(Lottery* lottery, const struct process* proc, unsigned int tickets) {
+    if ((unsigned int)proc->pid >= lottery->capacity) {
+        fenwick_grow(lottery, proc->pid);
+    }
+    lottery->procs[proc->pid] = proc;
+    fenwick_add(lottery, proc->pid, (int64_t)tickets - lottery->tickets[proc->pid]);
+    lottery->tickets[proc->pid] = tickets;
+}
+
+/* returns the pid holding the ticket-th ticket (0-based, < total) */
+static pid_t fenwick_find(const Lottery* lottery, uint64_t ticket) {
+    unsigned int pos = 0;
+    for (unsigned int step = lottery->capacity; step > 0; step /= 2) {
+        if (pos + step <= lottery->capacity && lottery->tree[pos + step] <= ticket) {
+            pos += step;
+            ticket -= lottery->tree[pos];
+        }
+    }
+    return pos;
+}
+
+/*************************************************************************
+ *
+ *                  Lottery Scheduler Implementation
+ *
+ * ************************************************************************/
+
+static uint64_t next_random(Lottery* lottery) {
+    lottery->random ^= lottery->random >> 12;
+    lottery->random ^= lottery->random << 25;
+    lottery->random ^= lottery->random >> 27;
+    return lottery->random * 0x2545F4914F6CDD1DULL;
+}
+
+/* draws a winning ticket and runs its holder (which may be the running
+ * process); leaves the CPU alone if nothing is ready */
+static void draw(Lottery* lottery) {
+    while (lottery->total > 0) {
+        // total is far below 2^64, so the modulo bias is negligible
+        uint64_t ticket = next_random(lottery) % lottery->total;
+        pid_t winner = fenwick_find(lottery, ticket);
+        if (READY != lottery->procs[winner]->state) {
+            // its burst ended this tick, before its blocked() / terminated()
+            set_tickets(lottery, lottery->procs[winner], 0);
+            continue;
+        }
+        if (winner != get_current_proc()) {
+            context_switch(winner);
+        }
+        return;
+    }
+}
+
+/* a process with no tickets still gets drawn once everyone else is waiting */
+static unsigned int tickets_of(const struct process* proc) {
+    return (proc->tickets > 0) ? proc->tickets : 1;
+}
+
+
+/* lottery_init
+ *   will be called exactly once before any processes arrive or any other events
+ */
+static void* lottery_init(const char* params) {
+    use_time_slice(TRUE);
+    Lottery* lottery = calloc(1, sizeof(Lottery));
+    assert(lottery != NULL);
+    // splitmix the seed so nearby seeds give unrelated sequences (and never 0)
+    uint64_t seed = get_policy_param(params, "seed", 1) + 0x9E3779B97F4A7C15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+    seed ^= seed >> 31;
+    lottery->random = (seed != 0) ? seed : 1;
+    return lottery;
+}
+
+
+/* lottery_new_process
+ *   will be called when a new process arrives (i.e., fork())
+ *
+ * proc - the new process that just arrived
+ */
+static void lottery_new_process(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    Lottery* lottery = state;
+
+    set_tickets(lottery, proc, tickets_of(proc));
+    if (get_current_proc() == -1) {
+        draw(lottery);
+    }
+}
+
+
+/* lottery_finished_time_slice
+ *   will be called when the running process finished a time slice
+ *
+ * proc - the process whose time slice just ended
+ */
+static void lottery_finished_time_slice(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    (void)proc; // (only asserted on)
+    draw(state);
+}
+
+
+/* lottery_blocked
+ *   will be called when the running process blocks
+ *
+ * proc - the process that just blocked
+ */
+static void lottery_blocked(void* state, int cpu, const struct process* proc) {
+    assert(BLOCKED == proc->state);
+    (void)cpu; // single CPU
+    Lottery* lottery = state;
+
+    set_tickets(lottery, proc, 0);
+    pid_t current = get_current_proc();
+    if (current == -1 || current == proc->pid) {
+        draw(lottery);
+    }
+}
+
+
+/* lottery_unblocked
+ *   will be called when a blocked process unblocks
+ *
+ * proc - the process that just unblocked
+ */
+static void lottery_unblocked(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    Lottery* lottery = state;
+
+    set_tickets(lottery, proc, tickets_of(proc));
+    if (get_current_proc() == -1) {
+        draw(lottery);
+    }
+}
+
+
+/* lottery_terminated
+ *   will be called when the running process terminates
+ *
+ * proc - the process that just terminated
+ */
+static void lottery_terminated(void* state, int cpu, const struct process* proc) {
+    assert(TERMINATED == proc->state);
+    (void)cpu; // single CPU
+    Lottery* lottery = state;
+
+    set_tickets(lottery, proc, 0);
+    pid_t current = get_current_proc();
+    if (current == -1 || current == proc->pid) {
+        draw(lottery);
+    }
+}
+
+
+/* lottery_cleanup
+ *   will be called exactly once after all processes have terminated and there
+ *   are no more events left to occur
+ */
+static void lottery_cleanup(void* state) {
+    Lottery* lottery = state;
+    free(lottery->procs);
+    free(lottery->tickets);
+    free(lottery->tree);
+    free(lottery);
+}
+
+
+/* lottery_save
+ *   writes the generator's state and the tickets every known process holds
+ */
+static void lottery_save(void* state, FILE* file) {
+    Lottery* lottery = state;
+    fwrite(&lottery->random, sizeof(uint64_t), 1, file);
+    unsigned int num_known = 0;
+    for (unsigned int pid = 0; pid < lottery->capacity; ++pid) {
+        num_known += (lottery->procs[pid] != NULL);
+    }
+    fwrite(&num_known, sizeof(num_known), 1, file);
+    for (pid_t pid = 0; (unsigned int)pid < lottery->capacity; ++pid) {
+        if (lottery->procs[pid] != NULL) {
+            fwrite(&pid, sizeof(pid), 1, file);
+            fwrite(&lottery->tickets[pid], sizeof(unsigned int), 1, file);
+        }
+    }
+}
+
+
+/* lottery_restore
+ *   rebuilds what lottery_save() wrote; the draws carry on from where they
+ *   were (a seed given now is ignored)
+ */
+static void* lottery_restore(const char* params, FILE* file) {
+    (void)params;
+    Lottery* lottery = calloc(1, sizeof(Lottery));
+    assert(lottery != NULL);
+    unsigned int num_known;
+    int ok = (fread(&lottery->random, sizeof(uint64_t), 1, file) == 1 && lottery->random != 0 &&
+              fread(&num_known, sizeof(num_known), 1, file) == 1);
+    for (unsigned int i = 0; ok && i < num_known; ++i) {
+        pid_t pid;
+        unsigned int tickets;
+        ok = (fread(&pid, sizeof(pid), 1, file) == 1 && fread(&tickets, sizeof(tickets), 1, file) == 1 &&
+              get_process(pid) != NULL);
+        if (ok) {
+            set_tickets(lottery, get_process(pid), tickets);
+        }
+    }
+    if (!ok) {
+        lottery_cleanup(lottery);
+        return NULL;
+    }
+    return lottery;
+}
+
+
+static const char* const lottery_params[] = {"seed", NULL};
+
+const struct sched_policy lottery_policy = {
+    .name = "lottery",
+    .multi_cpu = FALSE,
+    .params = lottery_params,
+    .init = lottery_init,
+    .new_process = lottery_new_process,
+    .finished_time_slice = lottery_finished_time_slice,
+    .blocked = lottery_blocked,
+    .unblocked = lottery_unblocked,
+    .terminated = lottery_terminated,
+    .cleanup = lottery_cleanup,
+    .save = lottery_save,
+    .restore = lottery_restore,
+};
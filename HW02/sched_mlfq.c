@@ -0,0 +1,452 @@
+#include "scheduler.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Multi-level feedback queue.
+ *
+ * A new process starts at level 0, the highest priority; a process that uses
+ * up its whole quantum drops a level, one that blocks first keeps its level.
+ * Level i runs for quantum << i ticks (quantum defaults to the workload's time
+ * slice).  A process arriving or unblocking at a higher level than the running
+ * one preempts it.  Every boost ticks all processes go back to level 0, so
+ * long-running ones do not starve.
+ *
+ * Parameters (--policy=mlfq:levels=N:quantum=N:boost=N):
+ *   levels  - number of levels, 1 .. MAX_LEVELS (default 8)
+ *   quantum - level 0's time slice in ticks (default: the workload's)
+ *   boost   - ticks between priority boosts, 0 for none (default 100 level 0 quanta)
+ *
+ * As in the Linux O(1) scheduler, a bitmap marks the non-empty levels, so
+ * picking the next process is a find-first-set over MAX_LEVELS / 64 words
+ * plus a queue pop, whatever the number of ready processes.  A boost splices
+ * every level onto level 0 and bumps an epoch instead of visiting each
+ * process; a process whose epoch is stale is at level 0.
+ */
+
+#define MAX_LEVELS 256
+#define BITMAP_WORDS (MAX_LEVELS / 64)
+#define MAX_QUANTUM_SHIFT 16 // level i's quantum stops growing past quantum << 16
+
+/* FIFO queues over one node per pid, linked by pid like sched_rr.c's.  Only
+ * waiting processes are queued; the running process is on none. */
+typedef struct {
+    pid_t front;
+    pid_t back;
+} Queue;
+
+typedef struct {
+    const struct process* proc;
+    pid_t next;
+    unsigned int level;
+    unsigned int epoch; // the boost epoch level belongs to
+} Node;
+
+/* Everything the scheduler keeps for one simulation (its policy state) */
+typedef struct {
+    Node* nodes; // array index = pid
+    unsigned int num_nodes;
+
+    Queue queues[MAX_LEVELS];
+    uint64_t bitmap[BITMAP_WORDS]; // bit i set if queues[i] is not empty
+    unsigned int num_levels;
+
+    time_ticks_t quantum;
+    time_ticks_t boost;
+    time_ticks_t next_boost;
+    unsigned int epoch;
+} MLFQ;
+
+/***********************get_node*********************** */
+static Node* get_node(MLFQ* mlfq, const struct process* proc) {
+    if ((unsigned int)proc->pid >= mlfq->num_nodes) {
+        unsigned int new_size = (mlfq->num_nodes == 0) ? 64 : mlfq->num_nodes;
+        while (new_size <= (unsigned int)proc->pid) {
+            new_size *= 2;
+        }
+        mlfq->nodes = realloc(mlfq->nodes, new_size * sizeof(Node));
+        assert(mlfq->nodes != NULL);
+        // level 0 in epoch 0, so a new process starts at the top
+        memset(&mlfq->nodes[mlfq->num_nodes], 0, (new_size - mlfq->num_nodes) * sizeof(Node));
+        mlfq->num_nodes = new_size;
+    }
+    Node* node = &mlfq->nodes[proc->pid];
+    node->proc = proc;
+    return node;
+}
+
+/***********************get_level********************** */
+static unsigned int get_level(const MLFQ* mlfq, const Node* node) {
+    return (node->epoch == mlfq->epoch) ? node->level : 0;
+}
+
+static void set_level(MLFQ* mlfq, Node* node, unsigned int level) {
+    node->level = level;
+    node->epoch = mlfq->epoch;
+}
+
+/***********************enqueue************************ */
+static void push(MLFQ* mlfq, unsigned int level, pid_t pid, bool_t front) {
+    Node* node = &mlfq->nodes[pid];
+    Queue* q = &mlfq->queues[level];
+
+    if (q->front == -1) {
+        node->next = -1;
+        q->front = q->back = pid;
+        mlfq->bitmap[level / 64] |= 1ULL << (level % 64);
+    } else if (front) {
+        node->next = q->front;
+        q->front = pid;
+    } else {
+        node->next = -1;
+        mlfq->nodes[q->back].next = pid;
+        q->back = pid;
+    }
+}
+
+static void enqueue(MLFQ* mlfq, const struct process* proc, bool_t front) {
+    Node* node = get_node(mlfq, proc);
+    push(mlfq, get_level(mlfq, node), proc->pid, front);
+}
+
+/* returns the highest non-empty level, or -1 if nothing is waiting */
+static int first_level(const MLFQ* mlfq) {
+    for (unsigned int word = 0; word < BITMAP_WORDS; ++word) {
+        if (mlfq->bitmap[word] != 0)
+            return word * 64 + __builtin_ctzll(mlfq->bitmap[word]);
+    }
+    return -1;
+}
+
+/***********************dequeue************************ */
+/* pops the front of the highest non-empty level, or returns -1 */
+static pid_t dequeue(MLFQ* mlfq) {
+    int level = first_level(mlfq);
+    if (level == -1) {
+        return -1;
+    }
+    Queue* q = &mlfq->queues[level];
+    pid_t pid = q->front;
+    q->front = mlfq->nodes[pid].next;
+    if (q->front == -1) {
+        q->back = -1;
+        mlfq->bitmap[level / 64] &= ~(1ULL << (level % 64));
+    }
+    // pinning its level to this epoch keeps a process boosted by a splice at 0
+    set_level(mlfq, &mlfq->nodes[pid], level);
+    return pid;
+}
+
+/*******************priority_boost********************* */
+/* moves every waiting process to level 0 (and the rest via the epoch) if a
+ * boost is due */
+static void priority_boost(MLFQ* mlfq) {
+    time_ticks_t now = get_current_time();
+    if (mlfq->boost == 0 || now < mlfq->next_boost) {
+        return;
+    }
+    Queue* top = &mlfq->queues[0];
+    for (unsigned int level = 1; level < mlfq->num_levels; ++level) {
+        Queue* q = &mlfq->queues[level];
+        if (q->front == -1) {
+            continue;
+        }
+        if (top->front == -1) {
+            top->front = q->front;
+        } else {
+            mlfq->nodes[top->back].next = q->front;
+        }
+        top->back = q->back;
+        q->front = q->back = -1;
+    }
+    memset(mlfq->bitmap, 0, sizeof(mlfq->bitmap));
+    if (top->front != -1) {
+        mlfq->bitmap[0] = 1;
+    }
+    ++mlfq->epoch;
+    mlfq->next_boost = now - now % mlfq->boost + mlfq->boost;
+}
+
+/***********************dispatch*********************** */
+/* runs pid for its level's quantum */
+static void dispatch(MLFQ* mlfq, pid_t pid) {
+    unsigned int level = get_level(mlfq, &mlfq->nodes[pid]);
+    unsigned int shift = (level < MAX_QUANTUM_SHIFT) ? level : MAX_QUANTUM_SHIFT;
+    set_time_slice(mlfq->quantum << shift);
+    if (pid != get_current_proc()) {
+        context_switch(pid);
+    }
+}
+
+/* runs the next waiting process if the CPU is free */
+static void run_next(MLFQ* mlfq) {
+    pid_t pid = dequeue(mlfq);
+    if (pid != -1) {
+        dispatch(mlfq, pid);
+    }
+}
+
+/* queues a process that became ready and preempts the running one if the new
+ * one is at a higher level */
+static void make_ready(MLFQ* mlfq, const struct process* proc) {
+    enqueue(mlfq, proc, FALSE);
+    pid_t current = get_current_proc();
+    if (current == -1) {
+        run_next(mlfq);
+        return;
+    }
+    Node* running = &mlfq->nodes[current];
+    if (READY != running->proc->state) {
+        // its burst just ended; its blocked() / terminated() will pick the next one
+        return;
+    }
+    if (get_level(mlfq, &mlfq->nodes[proc->pid]) < get_level(mlfq, running)) {
+        // the preempted process goes first among its level when it gets to run again
+        enqueue(mlfq, running->proc, TRUE);
+        run_next(mlfq);
+    }
+}
+
+
+/* mlfq_init
+ *   will be called exactly once before any processes arrive or any other events
+ */
+static MLFQ* create_mlfq(unsigned long num_levels) {
+    MLFQ* mlfq = calloc(1, sizeof(MLFQ));
+    assert(mlfq != NULL);
+    if (num_levels < 1) {
+        num_levels = 1;
+    } else if (num_levels > MAX_LEVELS) {
+        num_levels = MAX_LEVELS;
+    }
+    mlfq->num_levels = num_levels;
+    for (unsigned int level = 0; level < MAX_LEVELS; ++level) {
+        mlfq->queues[level].front = -1;
+        mlfq->queues[level].back = -1;
+    }
+    return mlfq;
+}
+
+static void* mlfq_init(const char* params) {
+    use_time_slice(TRUE);
+
+    MLFQ* mlfq = create_mlfq(get_policy_param(params, "levels", 8));
+    mlfq->quantum = get_policy_param(params, "quantum", get_time_slice());
+    mlfq->boost = get_policy_param(params, "boost", 100 * (unsigned long)mlfq->quantum);
+    mlfq->next_boost = mlfq->boost;
+    return mlfq;
+}
+
+
+/* mlfq_new_process
+ *   will be called when a new process arrives (i.e., fork())
+ *
+ * proc - the new process that just arrived
+ */
+static void mlfq_new_process(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    MLFQ* mlfq = state;
+
+    priority_boost(mlfq);
+    set_level(mlfq, get_node(mlfq, proc), 0);
+    make_ready(mlfq, proc);
+}
+
+
+/* mlfq_finished_time_slice
+ *   will be called when the running process finished a time slice
+ *
+ * proc - the process whose time slice just ended
+ */
+static void mlfq_finished_time_slice(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    MLFQ* mlfq = state;
+
+    priority_boost(mlfq);
+    // it used its whole quantum: down a level
+    Node* node = get_node(mlfq, proc);
+    unsigned int level = get_level(mlfq, node);
+    if (level + 1 < mlfq->num_levels) {
+        ++level;
+    }
+    set_level(mlfq, node, level);
+    enqueue(mlfq, proc, FALSE);
+    run_next(mlfq);
+}
+
+
+/* mlfq_blocked
+ *   will be called when the running process blocks
+ *
+ * proc - the process that just blocked
+ */
+static void mlfq_blocked(void* state, int cpu, const struct process* proc) {
+    assert(BLOCKED == proc->state);
+    (void)cpu; // single CPU
+    MLFQ* mlfq = state;
+
+    priority_boost(mlfq);
+    // it keeps its level; the CPU is free unless another process already took it
+    pid_t current = get_current_proc();
+    if (current == -1 || current == proc->pid) {
+        run_next(mlfq);
+    }
+}
+
+
+/* mlfq_unblocked
+ *   will be called when a blocked process unblocks
+ *
+ * proc - the process that just unblocked
+ */
+static void mlfq_unblocked(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    (void)cpu; // single CPU
+    MLFQ* mlfq = state;
+
+    priority_boost(mlfq);
+    make_ready(mlfq, proc);
+}
+
+
+/* mlfq_terminated
+ *   will be called when the running process terminates
+ *
+ * proc - the process that just terminated
+ */
+static void mlfq_terminated(void* state, int cpu, const struct process* proc) {
+    assert(TERMINATED == proc->state);
+    (void)cpu; // single CPU
+    MLFQ* mlfq = state;
+
+    priority_boost(mlfq);
+    pid_t current = get_current_proc();
+    if (current == -1 || current == proc->pid) {
+        run_next(mlfq);
+    }
+}
+
+
+/* mlfq_cleanup
+ *   will be called exactly once after all processes have terminated and there
+ *   are no more events left to occur
+ */
+static void mlfq_cleanup(void* state) {
+    MLFQ* mlfq = state;
+    free(mlfq->nodes);
+    free(mlfq);
+}
+
+
+/* mlfq_save
+ *   writes the parameters, every known process's level and the queues
+ */
+static void mlfq_save(void* state, FILE* file) {
+    MLFQ* mlfq = state;
+    fwrite(&mlfq->num_levels, sizeof(unsigned int), 1, file);
+    fwrite(&mlfq->quantum, sizeof(time_ticks_t), 1, file);
+    fwrite(&mlfq->boost, sizeof(time_ticks_t), 1, file);
+    fwrite(&mlfq->next_boost, sizeof(time_ticks_t), 1, file);
+    fwrite(&mlfq->epoch, sizeof(unsigned int), 1, file);
+
+    unsigned int num_known = 0;
+    for (unsigned int pid = 0; pid < mlfq->num_nodes; ++pid) {
+        num_known += (mlfq->nodes[pid].proc != NULL);
+    }
+    fwrite(&num_known, sizeof(num_known), 1, file);
+    for (pid_t pid = 0; (unsigned int)pid < mlfq->num_nodes; ++pid) {
+        if (mlfq->nodes[pid].proc != NULL) {
+            fwrite(&pid, sizeof(pid), 1, file);
+            fwrite(&mlfq->nodes[pid].level, sizeof(unsigned int), 1, file);
+            fwrite(&mlfq->nodes[pid].epoch, sizeof(unsigned int), 1, file);
+        }
+    }
+    // each level's queue front to back, ended by -1
+    pid_t end = -1;
+    for (unsigned int level = 0; level < mlfq->num_levels; ++level) {
+        for (pid_t pid = mlfq->queues[level].front; pid != -1; pid = mlfq->nodes[pid].next) {
+            fwrite(&pid, sizeof(pid), 1, file);
+        }
+        fwrite(&end, sizeof(end), 1, file);
+    }
+}
+
+
+/* mlfq_restore
+ *   rebuilds what mlfq_save() wrote; parameters given now replace the saved
+ *   ones (with fewer levels, the lower ones merge into the last)
+ */
+static void* mlfq_restore(const char* params, FILE* file) {
+    unsigned int num_levels, epoch;
+    time_ticks_t quantum, boost, next_boost;
+    if (fread(&num_levels, sizeof(num_levels), 1, file) != 1 || fread(&quantum, sizeof(quantum), 1, file) != 1 ||
+        fread(&boost, sizeof(boost), 1, file) != 1 || fread(&next_boost, sizeof(next_boost), 1, file) != 1 ||
+        fread(&epoch, sizeof(epoch), 1, file) != 1 || num_levels < 1 || num_levels > MAX_LEVELS) {
+        return NULL;
+    }
+    MLFQ* mlfq = create_mlfq(get_policy_param(params, "levels", num_levels));
+    mlfq->quantum = get_policy_param(params, "quantum", quantum);
+    mlfq->boost = get_policy_param(params, "boost", boost);
+    mlfq->next_boost = next_boost;
+    if (mlfq->boost != boost && mlfq->boost > 0) {
+        time_ticks_t now = get_current_time();
+        mlfq->next_boost = now - now % mlfq->boost + mlfq->boost;
+    }
+    mlfq->epoch = epoch;
+
+    unsigned int num_known;
+    int ok = (fread(&num_known, sizeof(num_known), 1, file) == 1);
+    for (unsigned int i = 0; ok && i < num_known; ++i) {
+        pid_t pid;
+        unsigned int level;
+        ok = (fread(&pid, sizeof(pid), 1, file) == 1 && fread(&level, sizeof(level), 1, file) == 1 &&
+              fread(&epoch, sizeof(epoch), 1, file) == 1 && get_process(pid) != NULL);
+        if (ok) {
+            Node* node = get_node(mlfq, get_process(pid));
+            node->level = (level < mlfq->num_levels) ? level : mlfq->num_levels - 1;
+            node->epoch = epoch;
+        }
+    }
+    for (unsigned int pid = 0; pid < mlfq->num_nodes; ++pid) {
+        mlfq->nodes[pid].next = -2; // not queued yet
+    }
+    for (unsigned int level = 0; ok && level < num_levels; ++level) {
+        unsigned int target = (level < mlfq->num_levels) ? level : mlfq->num_levels - 1;
+        pid_t pid;
+        while ((ok = (fread(&pid, sizeof(pid), 1, file) == 1)) && pid != -1) {
+            // only known processes are queued, and on one queue at most
+            ok = (pid >= 0 && (unsigned int)pid < mlfq->num_nodes && mlfq->nodes[pid].proc != NULL &&
+                  mlfq->nodes[pid].next == -2);
+            if (!ok) {
+                break;
+            }
+            push(mlfq, target, pid, FALSE);
+        }
+    }
+    if (!ok) {
+        mlfq_cleanup(mlfq);
+        return NULL;
+    }
+    return mlfq;
+}
+
+
+static const char* const mlfq_params[] = {"levels", "quantum", "boost", NULL};
+
+const struct sched_policy mlfq_policy = {
+    .name = "mlfq",
+    .multi_cpu = FALSE,
+    .params = mlfq_params,
+    .init = mlfq_init,
+    .new_process = mlfq_new_process,
+    .finished_time_slice = mlfq_finished_time_slice,
+    .blocked = mlfq_blocked,
+    .unblocked = mlfq_unblocked,
+    .terminated = mlfq_terminated,
+    .cleanup = mlfq_cleanup,
+    .save = mlfq_save,
+    .restore = mlfq_restore,
+};
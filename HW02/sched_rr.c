@@ -6,243 +6,555 @@
 
 
 
+/* Intrusive doubly linked queues over one node per pid.  Links are pids
+ * rather than pointers so the node array can grow with realloc; every queue
+ * operation, including removing a process from the middle, is O(1) and does
+ * not allocate. */
+typedef struct {
+    pid_t front;
+    pid_t back;
+    unsigned int length;
+} Queue;
+
 typedef struct Node {
     const struct process* proc;
-    struct Node* next;
+    pid_t prev;
+    pid_t next;
+    Queue* queue; // the queue this process is on, or NULL
 } Node;
 
+/* Everything the scheduler keeps for one simulation (its policy state) */
 typedef struct {
-    Node* front;
-    Node* back;
-} Queue;
+    Node* nodes; // array index = pid
+    unsigned int num_nodes;
 
-Queue ready_procqueue;
-Queue blocked_procqueue;
+    Queue* ready_procqueues; // array index = cpu; the front of each is running on that cpu
+    unsigned int num_ready_procqueues;
+    Queue blocked_procqueue;
+
+    pid_t* batch_running_buffer; // array index = cpu; scratch for rr_events_batch()
+    pid_t* batch_running; // the buffer during rr_events_batch(), NULL otherwise
+} RR;
 
 /************************init_queue******************** */
-void init_queue(Queue* q) {
-    q->front = NULL;
-    q->back = NULL;	
+static void init_queue(Queue* q) {
+    q->front = -1;
+    q->back = -1;
+    q->length = 0;
+}
+
+/***********************get_node*********************** */
+static Node* get_node(RR* rr, const struct process* proc) {
+    if ((unsigned int)proc->pid >= rr->num_nodes) {
+        unsigned int new_size = (rr->num_nodes == 0) ? 64 : rr->num_nodes;
+        while (new_size <= (unsigned int)proc->pid) {
+            new_size *= 2;
+        }
+        rr->nodes = realloc(rr->nodes, new_size * sizeof(Node));
+        assert(rr->nodes != NULL);
+        memset(&rr->nodes[rr->num_nodes], 0, (new_size - rr->num_nodes) * sizeof(Node));
+        rr->num_nodes = new_size;
+    }
+    Node* node = &rr->nodes[proc->pid];
+    node->proc = proc;
+    return node;
 }
 
 /***********************enqueue************************ */
-void enqueue(Queue* q, const struct process* proc) {
-    Node* new_node = malloc(sizeof(Node));
-    assert(new_node != NULL);
+static void enqueue(RR* rr, Queue* q, const struct process* proc) {
+    Node* new_node = get_node(rr, proc);
+    assert(new_node->queue == NULL);
+
+    new_node->queue = q;
+    new_node->next = -1;
+    new_node->prev = q->back;
+
+    if (q->back == -1) {
+        q->front = q->back = proc->pid;
+    } else {
+        rr->nodes[q->back].next = proc->pid;
+        q->back = proc->pid;
+    }
+    ++q->length;
+}
 
-    new_node->proc = proc;
-    new_node->next = NULL;
+/******************dequeue_process********************* */
+static void dequeue_process(RR* rr, Queue* q, const struct process* proc) {
+    if ((unsigned int)proc->pid >= rr->num_nodes || rr->nodes[proc->pid].queue != q) {
+        return;
+    }
+    Node* node = &rr->nodes[proc->pid];
 
-    if (q->back == NULL) {
-        q->front = q->back = new_node;
+    if (node->prev == -1) {
+        q->front = node->next;
     } else {
-        q->back->next = new_node;
-        q->back = new_node;
+        rr->nodes[node->prev].next = node->next;
     }
+    if (node->next == -1) {
+        q->back = node->prev;
+    } else {
+        rr->nodes[node->next].prev = node->prev;
+    }
+    node->queue = NULL;
+    --q->length;
 }
 
 /***********************dequeue************************ */
-const struct process* dequeue(Queue* q) {
+static const struct process* dequeue(RR* rr, Queue* q) {
     
-    if (q->front == NULL) {
+    if (q->front == -1) {
         return NULL;
     }
 
-    const struct process* proc = q->front->proc;
+    const struct process* proc = rr->nodes[q->front].proc;
+    dequeue_process(rr, q, proc);
+    return proc;
+}
 
-    Node* temp = q->front;
-    q->front = q->front->next;
+/**********************queue_front********************* */
+static const struct process* queue_front(RR* rr, Queue* q) {
+    if (q->front == -1) {
+        return NULL;
+    }
+    return rr->nodes[q->front].proc;
+}
 
-    if (q->front == NULL) {
-        q->back = NULL;
+/**********************free_queue***************************** */
+static void free_queue(RR* rr, Queue* q) {
+    while (q->front != -1) {
+        dequeue(rr, q);
     }
+}
 
-    free(temp);
-    return proc;
+/**********************save_queue***************************** */
+/* writes the queue's length and then its pids, front to back */
+static void save_queue(RR* rr, Queue* q, FILE* file) {
+    fwrite(&q->length, sizeof(q->length), 1, file);
+    for (pid_t pid = q->front; pid != -1; pid = rr->nodes[pid].next) {
+        fwrite(&pid, sizeof(pid), 1, file);
+    }
 }
 
-/**********************free_queue***************************** */
-void free_queue(Queue* q) {
-    while (q->front != NULL) {
-        Node* temp = q->front;
-        q->front = q->front->next;
-        free(temp);
-    }
-    q->back = NULL;
-}
-void dequeue_process(Queue *q, const struct process* proc) {
-    Node** current = &(q->front);
-    while (*current != NULL && (*current)->proc != proc) {
-        current = &((*current)->next);
-    }
-    //Node* blk = NULL;
-    if (*current != NULL) {
-        Node* temp = *current;
-        //blk = *current;
-        *current = (*current)->next;
-        if (q->front == NULL) {
-            q->back = NULL;
+/*********************restore_queue*************************** */
+/* reads back what save_queue() wrote; returns -1 if it does not fit */
+static int restore_queue(RR* rr, Queue* q, FILE* file) {
+    unsigned int length;
+    if (fread(&length, sizeof(length), 1, file) != 1) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < length; ++i) {
+        pid_t pid;
+        if (fread(&pid, sizeof(pid), 1, file) != 1) {
+            return -1;
         }
-        free(temp);
-
+        const struct process* proc = get_process(pid);
+        if (proc == NULL || get_node(rr, proc)->queue != NULL) {
+            return -1;
+        }
+        enqueue(rr, q, proc);
     }
+    return 0;
 }
 /*************************
  * ROUND ROBIN Scheduler *
  *************************/
 
-/* sched_init
- *   will be called exactly once before any processes arrive or any other events
+/* Each CPU round-robins over its own ready queue.  New and unblocked processes
+ * go to the CPU with the shortest queue (an idle one if possible, preferring
+ * the CPU an unblocked process last ran on), and a CPU whose queue runs dry
+ * steals the last process waiting on the longest other queue.  With one CPU
+ * this is plain round robin. */
+
+/* current_on
+ *   the process running on cpu, as the callbacks see it: during a batch, the
+ *   one the callbacks so far would have left there
  */
+static pid_t current_on(RR* rr, int cpu) {
+    return (rr->batch_running != NULL) ? rr->batch_running[cpu] : get_current_proc_on(cpu);
+}
 
-void sched_init() {
-    use_time_slice(TRUE);
-  
-    /*initialize queue of processes*/
-    init_queue(&ready_procqueue);
-    init_queue(&blocked_procqueue);
+/* pick_cpu
+ *   returns the CPU a newly ready process should queue on: the one with the
+ *   shortest ready queue, preferring preferred (if it is a valid CPU) on ties
+ */
+static int pick_cpu(RR* rr, int preferred) {
+    int best = (preferred >= 0 && (unsigned int)preferred < rr->num_ready_procqueues) ? preferred : 0;
+    for (unsigned int cpu = 0; cpu < rr->num_ready_procqueues && rr->ready_procqueues[best].length > 0; ++cpu) {
+        if (rr->ready_procqueues[cpu].length < rr->ready_procqueues[best].length) {
+            best = cpu;
+        }
+    }
+    return best;
 }
 
+/* last_waiting
+ *   returns the last process on cpu's ready queue that is waiting to run:
+ *   READY and not running on cpu (an unblocked process can run behind a front
+ *   that stopped at this time and has yet to be taken off), or NULL
+ */
+static const struct process* last_waiting(RR* rr, int cpu) {
+    for (pid_t pid = rr->ready_procqueues[cpu].back; pid != -1; pid = rr->nodes[pid].prev) {
+        const struct process* proc = rr->nodes[pid].proc;
+        if (proc->state == READY && pid != current_on(rr, cpu)) {
+            return proc;
+        }
+    }
+    return NULL;
+}
 
-/* sched_new_process
- *   will be called when a new process arrives (i.e., fork())
- *
- * proc - the new process that just arrived
+/* steal_work
+ *   moves the last process waiting on the longest other ready queue (if one has
+ *   a process waiting behind the running one) to the back of cpu's queue
  */
-void sched_new_process(const struct process* proc) {
-    assert(READY == proc->state);
+static void steal_work(RR* rr, int cpu) {
+    int victim = -1;
+    const struct process* proc = NULL;
+    for (unsigned int other = 0; other < rr->num_ready_procqueues; ++other) {
+        if ((int)other == cpu || rr->ready_procqueues[other].length < 2 ||
+            (victim != -1 && rr->ready_procqueues[other].length <= rr->ready_procqueues[victim].length)) {
+            continue;
+        }
+        const struct process* waiting = last_waiting(rr, other);
+        if (waiting != NULL) {
+            victim = other;
+            proc = waiting;
+        }
+    }
+    if (victim == -1) {
+        return;
+    }
+    dequeue_process(rr, &rr->ready_procqueues[victim], proc);
+    enqueue(rr, &rr->ready_procqueues[cpu], proc);
+}
 
-    enqueue(&ready_procqueue, proc);
+/* make_ready
+ *   queues a process that became ready on the CPU pick_cpu() gives it and
+ *   returns that CPU
+ */
+static int make_ready(RR* rr, int preferred, const struct process* proc) {
+    int cpu = pick_cpu(rr, preferred);
+    enqueue(rr, &rr->ready_procqueues[cpu], proc);
+    return cpu;
+}
 
-    pid_t curr = get_current_proc();
+/* leave_cpu
+ *   takes a process that stopped running on cpu off its ready queue, and
+ *   steals work for cpu if that leaves it nothing to run
+ */
+static void leave_cpu(RR* rr, int cpu, const struct process* proc) {
+    dequeue_process(rr, &rr->ready_procqueues[cpu], proc);
+    if (rr->ready_procqueues[cpu].length == 0) {
+        steal_work(rr, cpu);
+    }
+}
 
-    Node* top = (&ready_procqueue)->front;
-    if (top == NULL) {
-        return;
+static RR* create_rr(void) {
+    /*initialize queue of processes*/
+    RR* rr = calloc(1, sizeof(RR));
+    assert(rr != NULL);
+    rr->num_ready_procqueues = get_num_cpus();
+    rr->ready_procqueues = malloc(rr->num_ready_procqueues * sizeof(Queue));
+    assert(rr->ready_procqueues != NULL);
+    for (unsigned int cpu = 0; cpu < rr->num_ready_procqueues; ++cpu) {
+        init_queue(&rr->ready_procqueues[cpu]);
     }
+    init_queue(&rr->blocked_procqueue);
+    rr->batch_running_buffer = malloc(rr->num_ready_procqueues * sizeof(pid_t));
+    assert(rr->batch_running_buffer != NULL);
+    return rr;
+}
+
+/* rr_init
+ *   will be called exactly once before any processes arrive or any other events
+ */
+static void* rr_init(const char* params) {
+    (void)params; // takes none
+    use_time_slice(TRUE);
+    return create_rr();
+}
+
 
-    if (curr != top->proc->pid) {
-        if (curr == -1 && top->proc->state == READY){
-            context_switch(top->proc->pid);
+/* rr_event
+ *   applies one event to the queues and returns the process to switch *cpu
+ *   to, or -1 to leave it (*cpu becomes the CPU the process was queued on,
+ *   for new and unblocked processes)
+ */
+static pid_t rr_event(RR* rr, sched_event_type_t type, int* cpu, const struct process* proc) {
+    const struct process* top;
+    switch (type) {
+    case SCHED_NEW_PROCESS:
+        *cpu = make_ready(rr, *cpu, proc);
+        top = queue_front(rr, &rr->ready_procqueues[*cpu]);
+        if (current_on(rr, *cpu) == -1 && top->state == READY) {
+            return top->pid;
+        }
+        return -1;
+
+    case SCHED_FINISHED_TIME_SLICE:
+        /* rotate the finished process to the back of its CPU's ready queue */
+        dequeue_process(rr, &rr->ready_procqueues[*cpu], proc);
+        enqueue(rr, &rr->ready_procqueues[*cpu], proc);
+        break;
+
+    case SCHED_BLOCKED:
+        leave_cpu(rr, *cpu, proc);
+        enqueue(rr, &rr->blocked_procqueue, proc);
+        break;
+
+    case SCHED_UNBLOCKED:
+        dequeue_process(rr, &rr->blocked_procqueue, proc);
+        *cpu = make_ready(rr, *cpu, proc);
+        if (current_on(rr, *cpu) != -1) {
+            return -1;
         }
+        top = queue_front(rr, &rr->ready_procqueues[*cpu]);
+        return (top->state == READY) ? top->pid : proc->pid;
+
+    case SCHED_TERMINATED:
+        leave_cpu(rr, *cpu, proc);
+        break;
+    }
+
+    /* the process left the front of its CPU's queue: run the new front */
+    top = queue_front(rr, &rr->ready_procqueues[*cpu]);
+    if (top == NULL || top->pid == current_on(rr, *cpu) || top->state != READY) {
+        return -1;
+    }
+    return top->pid;
+}
+
+
+/* rr_new_process
+ *   will be called when a new process arrives (i.e., fork())
+ *
+ * cpu - always -1 (the process has not run yet)
+ * proc - the new process that just arrived
+ */
+static void rr_new_process(void* state, int cpu, const struct process* proc) {
+    assert(READY == proc->state);
+    pid_t pid = rr_event(state, SCHED_NEW_PROCESS, &cpu, proc);
+    if (pid != -1) {
+        context_switch_on(cpu, pid);
     }
 }
 
 
-/* sched_finished_time_slice
- *   will be called when the currently running process finished a time slice
+/* rr_finished_time_slice
+ *   will be called when the process running on cpu finished a time slice
  *   (This is only called when the time slice ends with time remaining in the
  *   current CPU burst.  If finishing the time slice happens at the same time
  *   that the process blocks / terminates,
- *   then sched_blocked() / sched_terminated() will be called instead).
+ *   then rr_blocked() / rr_terminated() will be called instead).
  *
+ * cpu - the CPU the process was running on
  * proc - the process whose time slice just ended
  *
  * Note: Time slice end events only occur if use_time_slice() is set to TRUE
  */
-void sched_finished_time_slice(const struct process* proc) {
+static void rr_finished_time_slice(void* state, int cpu, const struct process* proc) {
     assert(READY == proc->state);
-    
-    const struct process* fin_proc = dequeue(&ready_procqueue);
-
-    enqueue(&ready_procqueue, fin_proc);
-
-    Node* top = (&ready_procqueue)->front;
-
-    if (top->proc->pid != get_current_proc() && top->proc->state == READY){
-        context_switch(top->proc->pid);
+    pid_t pid = rr_event(state, SCHED_FINISHED_TIME_SLICE, &cpu, proc);
+    if (pid != -1) {
+        context_switch_on(cpu, pid);
     }
 }
 
 
-/* sched_blocked
- *   will be called when the currently running process blocks
+/* rr_blocked
+ *   will be called when the process running on cpu blocks
  *   (e.g., if it starts an I/O operation that it needs to wait to finish
  *
+ * cpu - the CPU the process was running on
  * proc - the process that just blocked
  */
-void sched_blocked(const struct process* proc) {
+static void rr_blocked(void* state, int cpu, const struct process* proc) {
     assert(BLOCKED == proc->state);
-
-    const struct process* blokd_proc = dequeue(&ready_procqueue);
-    (void) blokd_proc;
-
-    enqueue(&blocked_procqueue, proc);
-
-    Node* top = (&ready_procqueue)->front;
-    if (top == NULL){
-        return;
+    pid_t pid = rr_event(state, SCHED_BLOCKED, &cpu, proc);
+    if (pid != -1) {
+        context_switch_on(cpu, pid);
     }
-
-    if (top->proc->pid != get_current_proc() && top->proc->state == READY){
-        context_switch(top->proc->pid);
-    }  
 }
 
 
-/* sched_unblocked
+/* rr_unblocked
  *   will be called when a blocked process unblocks
  *   (e.g., if its I/O operation finished)
  *
+ * cpu - the CPU the process last ran on
  * proc - the process that just unblocked
  */
-void sched_unblocked(const struct process* proc) {
+static void rr_unblocked(void* state, int cpu, const struct process* proc) {
     assert(READY == proc->state);
-
-    enqueue(&ready_procqueue, proc);
-
-    Node* top = (&ready_procqueue)->front;
-    
-    if (get_current_proc() != top->proc->pid && get_current_proc() == -1) {
-        if (top->proc->state == READY){
-            context_switch(top->proc->pid);
-        }else{
-            context_switch(proc->pid);
-        }
+    pid_t pid = rr_event(state, SCHED_UNBLOCKED, &cpu, proc);
+    if (pid != -1) {
+        context_switch_on(cpu, pid);
     }
 }
 
 
-/* sched_terminated
- *   will be called when the currently running process terminates
+/* rr_terminated
+ *   will be called when the process running on cpu terminates
  *   (i.e., it finished it's last CPU burst)
  *
+ * cpu - the CPU the process was running on
  * proc - the process that just terminated
  *
  * Note: "kill" commands and other ways to terminate a process that is not
  *       currently running are not being simulated, so only the currently running
  *       process can actually terminate.
  */
-void sched_terminated(const struct process* proc) {
+static void rr_terminated(void* state, int cpu, const struct process* proc) {
     assert(TERMINATED == proc->state);
+    pid_t pid = rr_event(state, SCHED_TERMINATED, &cpu, proc);
+    if (pid != -1) {
+        context_switch_on(cpu, pid);
+    }
+}
 
-    const struct process* term_proc = dequeue(&ready_procqueue);
-    if (term_proc == NULL) {
-        return;
+
+/* rr_events_batch
+ *   will be called instead of the callbacks above with every event at the
+ *   current time, when the simulation batches events
+ *
+ * events - the events, in the order the callbacks would have been called;
+ *          each gets the CPU its callback would have switched
+ *
+ * Note: the events are played through as the callbacks would, against what
+ *       each CPU would be running by then; only the last switch on each CPU
+ *       actually happens
+ */
+static void rr_events_batch(void* state, struct sched_event* events, unsigned int num_events) {
+    RR* rr = state;
+    unsigned int num_cpus = rr->num_ready_procqueues;
+    pid_t* running = rr->batch_running_buffer;
+    for (unsigned int cpu = 0; cpu < num_cpus; ++cpu) {
+        running[cpu] = get_current_proc_on(cpu);
     }
-   
-    Node* top = (&ready_procqueue)->front;
-    if (top == NULL) {
-        return;
+    rr->batch_running = running;
+
+    for (unsigned int i = 0; i < num_events; ++i) {
+        int cpu = events[i].cpu;
+        pid_t pid = rr_event(rr, events[i].type, &cpu, events[i].proc);
+        if (pid != -1) {
+            running[cpu] = pid;
+            events[i].switched = cpu;
+        }
+        if (events[i].idles_stopped) {
+            for (unsigned int idle = 0; idle < num_cpus; ++idle) {
+                if (running[idle] != -1 && get_process(running[idle])->state != READY) {
+                    running[idle] = -1;
+                }
+            }
+        }
     }
-    
-    if (top->proc->pid != get_current_proc() && top->proc->state == READY){
-        context_switch(top->proc->pid);
+    rr->batch_running = NULL;
+
+    /* rr_event() only runs a process queued on that CPU, and a process is
+     * queued on one CPU at a time, so no process is meant for two CPUs */
+    for (unsigned int cpu = 0; cpu < num_cpus; ++cpu) {
+        for (unsigned int other = cpu + 1; other < num_cpus; ++other) {
+            assert(running[cpu] == -1 || running[cpu] != running[other]);
+        }
+    }
+
+    /* then switch; a process moving between CPUs waits for the one it runs
+     * on to move on first.  Every pass moves at least one CPU to the process
+     * meant for it, which then stays there, or ends the loop */
+    for (;;) {
+        bool_t switched = FALSE;
+        int waiting = -1;
+        for (unsigned int cpu = 0; cpu < num_cpus; ++cpu) {
+            pid_t pid = running[cpu];
+            if (pid == -1 || pid == get_current_proc_on(cpu)) {
+                continue;
+            }
+            int from = get_process(pid)->cpu;
+            if (from != -1 && get_current_proc_on(from) == pid) {
+                waiting = cpu;
+                continue;
+            }
+            context_switch_on(cpu, pid);
+            switched = TRUE;
+        }
+        if (!switched) {
+            if (waiting == -1) {
+                break;
+            }
+            /* every move waits on another (CPUs swapping processes): idle the
+             * CPU one waits on, which is not meant to keep it, and move it */
+            pid_t pid = running[waiting];
+            context_switch_idle(get_process(pid)->cpu);
+            context_switch_on(waiting, pid);
+        }
+    }
+    for (unsigned int cpu = 0; cpu < num_cpus; ++cpu) {
+        assert(running[cpu] == -1 || running[cpu] == get_current_proc_on(cpu));
     }
 }
 
 
-/* sched_cleanup
+/* rr_cleanup
  *   will be called exactly once after all processes have terminated and there
  *   are no more events left to occur, just before the simulation exits
  *
- * Note: Calling sched_cleanup() is guaranteed if the simulation has a normal exit
+ * Note: Calling rr_cleanup() is guaranteed if the simulation has a normal exit
  *       but is not guaranteed in the case of fatal errors, crashes, or other
  *       abnormal exits.
  */
-void sched_cleanup() {
-  // TODO: implement this
-    free_queue(&ready_procqueue);
-    free_queue(&blocked_procqueue);
+static void rr_cleanup(void* state) {
+    RR* rr = state;
+    for (unsigned int cpu = 0; cpu < rr->num_ready_procqueues; ++cpu) {
+        free_queue(rr, &rr->ready_procqueues[cpu]);
+    }
+    free(rr->ready_procqueues);
+    free(rr->batch_running_buffer);
+    free_queue(rr, &rr->blocked_procqueue);
+    free(rr->nodes);
+    free(rr);
+}
+
+
+/* rr_save
+ *   writes every ready queue and then the blocked queue
+ */
+static void rr_save(void* state, FILE* file) {
+    RR* rr = state;
+    for (unsigned int cpu = 0; cpu < rr->num_ready_procqueues; ++cpu) {
+        save_queue(rr, &rr->ready_procqueues[cpu], file);
+    }
+    save_queue(rr, &rr->blocked_procqueue, file);
 }
 
+
+/* rr_restore
+ *   rebuilds the queues rr_save() wrote (on as many CPUs)
+ */
+static void* rr_restore(const char* params, FILE* file) {
+    (void)params; // takes none
+    RR* rr = create_rr();
+    int ok = 1;
+    for (unsigned int cpu = 0; ok && cpu < rr->num_ready_procqueues; ++cpu) {
+        ok = (restore_queue(rr, &rr->ready_procqueues[cpu], file) == 0);
+    }
+    if (!ok || restore_queue(rr, &rr->blocked_procqueue, file) != 0) {
+        rr_cleanup(rr);
+        return NULL;
+    }
+    return rr;
+}
+
+
+const struct sched_policy rr_policy = {
+    .name = "rr",
+    .multi_cpu = TRUE,
+    .init = rr_init,
+    .new_process = rr_new_process,
+    .finished_time_slice = rr_finished_time_slice,
+    .blocked = rr_blocked,
+    .unblocked = rr_unblocked,
+    .terminated = rr_terminated,
+    .cleanup = rr_cleanup,
+    .save = rr_save,
+    .restore = rr_restore,
+    .events_batch = rr_events_batch,
+};
@@ -4,112 +4,215 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include <stdlib.h>
-#include <assert.h>
-
 /***************************************************************************
  * 
  *            Priority Queue Implementation for ready processes
  *
+ * Binary min-heap of pids keyed on (remaining_time, pid), where
+ * remaining_time is the burst length when the process was queued.  The
+ * per-pid srtf_info entries hold each process's key and heap slot, so finding
+ * the running process for the preemption check is O(1).
+ * 
  * *********************************************************************/
-typedef struct PQnode {
+typedef struct {
     const struct process* proc;
     time_ticks_t remaining_time;
-    struct PQnode* next;
-} PQnode;
+    int slot; // index in PQ.heap, or -1 if not queued
+} srtf_info;
 
 typedef struct {
-    PQnode* head;
-} PQ;
-PQ ready_procqueue;
+    pid_t* heap;
+    unsigned int size;
+    unsigned int capacity;
+    srtf_info* info; // array index = pid
+    unsigned int info_capacity;
 
+    // during stcf_events_batch(): the process the callbacks so far would have
+    // left running, and whether the one playing now switched
+    bool_t batching;
+    pid_t batch_current;
+    bool_t batch_switched;
+} PQ; // the policy state, one per simulation
 
 
-void init_pq(PQ* pq) {
-    pq->head = NULL;
-}
-
-void add_to_pq(PQ* q, const struct process* proc, time_ticks_t remaining_time) {
-    PQnode* new_node = (PQnode*)malloc(sizeof(PQnode));
-    assert(new_node != NULL);
 
-    new_node->proc = proc;
-    new_node->remaining_time = remaining_time;
-    new_node->next = NULL;
+static void init_pq(PQ* pq) {
+    memset(pq, 0, sizeof(PQ));
+}
 
-    PQnode** current = &(q->head);
-    while (*current != NULL) {
-        if ((*current)->remaining_time > remaining_time) {
+static int pq_before(PQ* q, pid_t a, pid_t b) {
+    if (q->info[a].remaining_time != q->info[b].remaining_time) {
+        return q->info[a].remaining_time < q->info[b].remaining_time;
+    }
+    return a < b;
+}
+static void pq_place(PQ* q, pid_t pid, unsigned int slot) {
+    q->heap[slot] = pid;
+    q->info[pid].slot = slot;
+}
+static void pq_sift_up(PQ* q, unsigned int slot) {
+    pid_t pid = q->heap[slot];
+    while (slot > 0) {
+        unsigned int parent = (slot - 1) / 2;
+        if (!pq_before(q, pid, q->heap[parent])) {
+            break;
+        }
+        pq_place(q, q->heap[parent], slot);
+        slot = parent;
+    }
+    pq_place(q, pid, slot);
+}
+static void pq_sift_down(PQ* q, unsigned int slot) {
+    pid_t pid = q->heap[slot];
+    for (;;) {
+        unsigned int child = 2 * slot + 1;
+        if (child >= q->size) {
             break;
-        } else if ((*current)->remaining_time == remaining_time && (*current)->proc->pid > proc->pid) {
+        }
+        if (child + 1 < q->size && pq_before(q, q->heap[child + 1], q->heap[child])) {
+            ++child;
+        }
+        if (!pq_before(q, q->heap[child], pid)) {
             break;
         }
-        current = &((*current)->next);
+        pq_place(q, q->heap[child], slot);
+        slot = child;
+    }
+    pq_place(q, pid, slot);
+}
+
+static void add_to_pq(PQ* q, const struct process* proc, time_ticks_t remaining_time) {
+    if ((unsigned int)proc->pid >= q->info_capacity) {
+        unsigned int new_capacity = (q->info_capacity == 0) ? 64 : q->info_capacity;
+        while (new_capacity <= (unsigned int)proc->pid) {
+            new_capacity *= 2;
+        }
+        q->info = realloc(q->info, new_capacity * sizeof(srtf_info));
+        assert(q->info != NULL);
+        for (unsigned int pid = q->info_capacity; pid < new_capacity; ++pid) {
+            q->info[pid].proc = NULL;
+            q->info[pid].slot = -1;
+        }
+        q->info_capacity = new_capacity;
+    }
+    if (q->size == q->capacity) {
+        q->capacity = (q->capacity == 0) ? 64 : 2 * q->capacity;
+        q->heap = realloc(q->heap, q->capacity * sizeof(pid_t));
+        assert(q->heap != NULL);
     }
-   
 
-    new_node->next = *current;
-    *current = new_node; 
+    srtf_info* info = &q->info[proc->pid];
+    assert(info->slot == -1);
+    info->proc = proc;
+    info->remaining_time = remaining_time;
+    pq_place(q, proc->pid, q->size++);
+    pq_sift_up(q, info->slot);
 }
 
-void remove_from_pq(PQ* q, const struct process* proc) {
-    PQnode** current = &(q->head);
-    while (*current != NULL && (*current)->proc != proc) {
-        current = &((*current)->next);
+static void remove_from_pq(PQ* q, const struct process* proc) {
+    if ((unsigned int)proc->pid >= q->info_capacity || q->info[proc->pid].slot == -1) {
+        return;
     }
-    if (*current != NULL) {
-        PQnode* temp = *current;
-        *current = (*current)->next;
-        free(temp);
+    unsigned int slot = q->info[proc->pid].slot;
+    q->info[proc->pid].slot = -1;
+    --q->size;
+    if (slot == q->size) {
+        return;
+    }
+    pq_place(q, q->heap[q->size], slot);
+    if (slot > 0 && pq_before(q, q->heap[slot], q->heap[(slot - 1) / 2])) {
+        pq_sift_up(q, slot);
+    } else {
+        pq_sift_down(q, slot);
     }
 }
 
-const struct process* get_process(PQ* q) {
-    if (q->head == NULL) {
+static const struct process* get_top_process(PQ* q) {
+    if (q->size == 0) {
         return NULL;
     }
 
-   return q->head->proc;
+   return q->info[q->heap[0]].proc;
 }
 
-void free_PQ(PQ* q) {
-    PQnode* current = q->head;
-    while (current != NULL) {
-        PQnode* temp = current;
-        current = current->next;
-        free(temp);
-    }
-    q->head = NULL;
+static void free_PQ(PQ* q) {
+    free(q->heap);
+    free(q->info);
+    memset(q, 0, sizeof(PQ));
 }
 
-void print_ready_queue(PQ* q) {
-    PQnode* current = q->head;
-    printf("Ready Queue: ");
-    while (current != NULL) {
-        printf("(pid=%d, remaining=%d) ", current->proc->pid, current->remaining_time);
-        current = current->next;
+#ifdef DEBUG
+static void print_ready_queue(PQ* q) {
+    printf("Ready Queue (heap order): ");
+    for (unsigned int slot = 0; slot < q->size; ++slot) {
+        const srtf_info* info = &q->info[q->heap[slot]];
+        printf("(pid=%d, remaining=%d) ", info->proc->pid, info->remaining_time);
     }
     printf("\n");
 }
-time_ticks_t get_curr_proc_time(PQ* q, pid_t pid) {
-    if (q->head == NULL) {
-        return -1;
-    }
-    PQnode* current = q->head;
-    while (current != NULL && current->proc->pid != pid) {
-        current = current->next;
+#endif // DEBUG
+/* returns the running process, as the callbacks see it: during a batch, the
+ * one the callbacks so far would have left running */
+static pid_t current_proc(PQ* q) {
+    return q->batching ? q->batch_current : get_current_proc();
+}
+/* context_switch(), or during a batch, notes that the callback would have
+ * (the simulator still hears of a process that is not READY, to refuse it as
+ * it would have) */
+static void switch_to(PQ* q, pid_t pid) {
+    if (!q->batching || get_process(pid)->state != READY) {
+        context_switch(pid);
+        return;
     }
-    return current->proc->current_burst->remaining_time;
+    q->batch_current = pid;
+    q->batch_switched = TRUE;
 }
-const struct process* get_curr_proc(PQ* q, pid_t pid) {
-    if (q->head == NULL) {
+/* returns the queued process with this pid, or NULL if it is not in the queue */
+static const struct process* get_curr_proc(PQ* q, pid_t pid) {
+    if (pid < 0 || (unsigned int)pid >= q->info_capacity || q->info[pid].slot == -1) {
         return NULL;
     }
-    PQnode* current = q->head;
-    while (current != NULL && current->proc->pid != pid) {
-        current = current->next;
+    return q->info[pid].proc;
+}
+/* returns the time left in the current burst of the queued process with this
+ * pid, or 0 if it is not in the queue */
+static time_ticks_t get_curr_proc_time(PQ* q, pid_t pid) {
+    const struct process* proc = get_curr_proc(q, pid);
+    if (proc == NULL || BURSTS_LEFT(proc) == 0) {
+        return 0;
+    }
+    return BURST_TIME(proc);
+}
+/* writes the queued pids and their keys in heap order */
+static void save_PQ(PQ* q, FILE* file) {
+    fwrite(&q->size, sizeof(q->size), 1, file);
+    for (unsigned int slot = 0; slot < q->size; ++slot) {
+        const srtf_info* info = &q->info[q->heap[slot]];
+        fwrite(&info->proc->pid, sizeof(pid_t), 1, file);
+        fwrite(&info->remaining_time, sizeof(time_ticks_t), 1, file);
     }
-    return current->proc;
+}
+
+/* reads back what save_PQ() wrote; in heap order, no entry moves when it is
+ * added; returns -1 if it does not fit */
+static int restore_PQ(PQ* q, FILE* file) {
+    unsigned int size;
+    if (fread(&size, sizeof(size), 1, file) != 1) {
+        return -1;
+    }
+    for (unsigned int slot = 0; slot < size; ++slot) {
+        pid_t pid;
+        time_ticks_t remaining_time;
+        if (fread(&pid, sizeof(pid), 1, file) != 1 || fread(&remaining_time, sizeof(remaining_time), 1, file) != 1) {
+            return -1;
+        }
+        const struct process* proc = get_process(pid);
+        if (proc == NULL || get_curr_proc(q, pid) != NULL) {
+            return -1;
+        }
+        add_to_pq(q, proc, remaining_time);
+    }
+    return 0;
 }
 /*******************************************************
  * SHORTEST TIME TO COMPLETION FIRST (STCF) Scheduler  *
@@ -117,57 +220,66 @@ const struct process* get_curr_proc(PQ* q, pid_t pid) {
  *******************************************************/
 
 
-/* sched_init
+static void stcf_blocked(void* state, int cpu, const struct process* proc);
+static void stcf_terminated(void* state, int cpu, const struct process* proc);
+
+/* stcf_init
  *   will be called exactly once before any processes arrive or any other events
  */
-void sched_init() {
+static void* stcf_init(const char* params) {
+    (void)params; // takes none
     use_time_slice(FALSE);
 
-    init_pq(&ready_procqueue);
+    PQ* ready_procqueue = malloc(sizeof(PQ));
+    assert(ready_procqueue != NULL);
+    init_pq(ready_procqueue);
+    return ready_procqueue;
   
 }
 
 
-/* sched_new_process
+/* stcf_new_process
  *   will be called when a new process arrives (i.e., fork())
  *
  * proc - the new process that just arrived
  */
 
- void sched_new_process(const struct process* proc) {
+static void stcf_new_process(void* state, int cpu, const struct process* proc) {
     assert(READY == proc->state);
+    PQ* ready_procqueue = state;
 
-    if (ready_procqueue.head == NULL) {
-        add_to_pq(&ready_procqueue, proc, proc->current_burst->remaining_time);
-        context_switch(proc->pid);
+    if (ready_procqueue->size == 0) {
+        add_to_pq(ready_procqueue, proc, BURST_TIME(proc));
+        switch_to(ready_procqueue, proc->pid);
         return;
     }
     
-    pid_t curr_pid = get_current_proc();
-    const struct process* curr_process = get_curr_proc(&ready_procqueue, curr_pid);
+    pid_t curr_pid = current_proc(ready_procqueue);
+    const struct process* curr_process = get_curr_proc(ready_procqueue, curr_pid);
 
-    add_to_pq(&ready_procqueue, proc, proc->current_burst->remaining_time);
+    add_to_pq(ready_procqueue, proc, BURST_TIME(proc));
 
-    const struct process* top_proc = get_process(&ready_procqueue);
+    const struct process* top_proc = get_top_process(ready_procqueue);
+
+    if (curr_process == NULL) {
+        // idle (or running something we are not tracking): run the shortest job
+        if (current_proc(ready_procqueue) != top_proc->pid) {
+            switch_to(ready_procqueue, top_proc->pid);
+        }
 
-    if (curr_process->state == BLOCKED) {
+    } else if (curr_process->state == BLOCKED) {
         //printf("current proc is blocked\n");
-        sched_blocked(curr_process);
+        stcf_blocked(state, cpu, curr_process);
     
     } else if (curr_process->state == TERMINATED) {
         //printf("current proc is terminated\n");
-        sched_terminated(curr_process);
+        stcf_terminated(state, cpu, curr_process);
 
-    } else if (get_current_proc() == -1) {
-        //printf("current proc is idle\n");
+    } else if (current_proc(ready_procqueue) != top_proc->pid) {
+        time_ticks_t time_left = get_curr_proc_time(ready_procqueue, current_proc(ready_procqueue));
         
-        context_switch(top_proc->pid);
-
-    } else if (get_current_proc() != top_proc->pid) {
-        time_ticks_t time_left = get_curr_proc_time(&ready_procqueue, get_current_proc());
-        
-        if (time_left >= top_proc->current_burst->remaining_time) {
-            context_switch(top_proc->pid);
+        if (time_left >= BURST_TIME(top_proc)) {
+            switch_to(ready_procqueue, top_proc->pid);
         }
         
     } 
@@ -175,61 +287,66 @@ void sched_init() {
 }
 
 
-/* sched_finished_time_slice
+/* stcf_finished_time_slice
  *   will be called when the currently running process finished a time slice
  *   (This is only called when the time slice ends with time remaining in the
  *   current CPU burst.  If finishing the time slice happens at the same time
  *   that the process blocks / terminates,
- *   then sched_blocked() / sched_terminated() will be called instead).
+ *   then stcf_blocked() / stcf_terminated() will be called instead).
  *
  * proc - the process whose time slice just ended
  *
  * Note: Time slice end events only occur if use_time_slice() is set to TRUE
  */
-void sched_finished_time_slice(const struct process* proc) {
-  assert(READY == proc->state);
-  // TODO: implement this
+static void stcf_finished_time_slice(void* state, int cpu, const struct process* proc) {
+    // never called: STCF runs without time slices (see stcf_init())
+    assert(READY == proc->state);
+    (void)state;
+    (void)cpu;
+    (void)proc; // (only asserted on)
 }
 
 
-/* sched_blocked
+/* stcf_blocked
  *   will be called when the currently running process blocks
  *   (e.g., if it starts an I/O operation that it needs to wait to finish
  *
  * proc - the process that just blocked
  */
-void sched_blocked(const struct process* proc) {
+static void stcf_blocked(void* state, int cpu, const struct process* proc) {
     assert(BLOCKED == proc->state);
+    (void)cpu; // single CPU
+    PQ* ready_procqueue = state;
    
     // Remove the blocked process from the ready queue
-    remove_from_pq(&ready_procqueue, proc);
+    remove_from_pq(ready_procqueue, proc);
 
 
     // switch to the next process in the ready queue
-    const struct process* next_proc = get_process(&ready_procqueue);
+    const struct process* next_proc = get_top_process(ready_procqueue);
     if (next_proc == NULL) {
         return;
     }
 
-    if (next_proc->pid != get_current_proc() || get_current_proc() == -1) {
-        context_switch(next_proc->pid);
+    if (next_proc->pid != current_proc(ready_procqueue) || current_proc(ready_procqueue) == -1) {
+        switch_to(ready_procqueue, next_proc->pid);
     } 
 }
 
-/* sched_unblocked
+/* stcf_unblocked
  *   will be called when a blocked process unblocks
  *   (e.g., if its I/O operation finished)
  *
  * proc - the process that just unblocked
  */
-void sched_unblocked(const struct process* proc) {
+static void stcf_unblocked(void* state, int cpu, const struct process* proc) {
     assert(READY == proc->state);
    
-    sched_new_process(proc);
+    stcf_new_process(state, cpu, proc);
 }
 
 
-/* sched_terminated
+/* stcf_terminated
  *   will be called when the currently running process terminates
  *   (i.e., it finished it's last CPU burst)
  *
@@ -239,31 +356,132 @@ void sched_unblocked(const struct process* proc) {
  *       currently running are not being simulated, so only the currently running
  *       process can actually terminate.
  */
-void sched_terminated(const struct process* proc) {
+static void stcf_terminated(void* state, int cpu, const struct process* proc) {
     assert(TERMINATED == proc->state);
+    (void)cpu; // single CPU
+    PQ* ready_procqueue = state;
 
     // Remove the terminated process from the ready queue
-    remove_from_pq(&ready_procqueue, proc);
+    remove_from_pq(ready_procqueue, proc);
 
-    const struct process* next_proc = get_process(&ready_procqueue);
+    const struct process* next_proc = get_top_process(ready_procqueue);
     if (next_proc == NULL) {
         return;
     }
-    if (next_proc->pid != get_current_proc() || get_current_proc() == -1) {
-        context_switch(next_proc->pid);
+    if (next_proc->pid != current_proc(ready_procqueue) || current_proc(ready_procqueue) == -1) {
+        switch_to(ready_procqueue, next_proc->pid);
     } 
 
 }
-/* sched_cleanup
+
+
+/* stcf_events_batch
+ *   will be called instead of the callbacks above with every event at the
+ *   current time, when the simulation batches events
+ *
+ * events - the events, in the order the callbacks would have been called;
+ *          each gets CPU 0 if its callback would have switched
+ *
+ * Note: the callbacks play the events through against what they would have
+ *       left running by then; only the last switch actually happens (a
+ *       process switched away from and back to starts over, as it would have)
+ */
+static void stcf_events_batch(void* state, struct sched_event* events, unsigned int num_events) {
+    PQ* ready_procqueue = state;
+    pid_t running = get_current_proc();
+    bool_t switched = FALSE;
+    ready_procqueue->batch_current = running;
+    ready_procqueue->batching = TRUE;
+    for (unsigned int i = 0; i < num_events; ++i) {
+        ready_procqueue->batch_switched = FALSE;
+        switch (events[i].type) {
+        case SCHED_NEW_PROCESS:
+            stcf_new_process(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_FINISHED_TIME_SLICE:
+            stcf_finished_time_slice(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_BLOCKED:
+            stcf_blocked(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_UNBLOCKED:
+            stcf_unblocked(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_TERMINATED:
+            stcf_terminated(state, events[i].cpu, events[i].proc);
+            break;
+        }
+        if (ready_procqueue->batch_switched) {
+            events[i].switched = 0;
+            switched = TRUE;
+        }
+        pid_t current = ready_procqueue->batch_current;
+        if (events[i].idles_stopped && current != -1 && get_process(current)->state != READY) {
+            ready_procqueue->batch_current = -1;
+        }
+    }
+    ready_procqueue->batching = FALSE;
+
+    pid_t current = ready_procqueue->batch_current;
+    if (current != -1 && switched) {
+        if (current == running) {
+            context_switch_idle(0);
+        }
+        context_switch(current);
+    }
+}
+
+
+/* stcf_cleanup
  *   will be called exactly once after all processes have terminated and there
  *   are no more events left to occur, just before the simulation exits
  *
- * Note: Calling sched_cleanup() is guaranteed if the simulation has a normal exit
+ * Note: Calling stcf_cleanup() is guaranteed if the simulation has a normal exit
  *       but is not guaranteed in the case of fatal errors, crashes, or other
  *       abnormal exits.
  */
-void sched_cleanup() {
-  // TODO: implement this
-    free_PQ(&ready_procqueue);
+static void stcf_cleanup(void* state) {
+    PQ* ready_procqueue = state;
+    free_PQ(ready_procqueue);
+    free(ready_procqueue);
 }
 
+
+/* stcf_save
+ *   writes the ready queue
+ */
+static void stcf_save(void* state, FILE* file) {
+    save_PQ(state, file);
+}
+
+
+/* stcf_restore
+ *   rebuilds the ready queue stcf_save() wrote
+ */
+static void* stcf_restore(const char* params, FILE* file) {
+    (void)params; // takes none
+    PQ* ready_procqueue = malloc(sizeof(PQ));
+    assert(ready_procqueue != NULL);
+    init_pq(ready_procqueue);
+    if (restore_PQ(ready_procqueue, file) != 0) {
+        stcf_cleanup(ready_procqueue);
+        return NULL;
+    }
+    return ready_procqueue;
+}
+
+
+const struct sched_policy stcf_policy = {
+    .name = "stcf",
+    .multi_cpu = FALSE,
+    .init = stcf_init,
+    .new_process = stcf_new_process,
+    .finished_time_slice = stcf_finished_time_slice,
+    .blocked = stcf_blocked,
+    .unblocked = stcf_unblocked,
+    .terminated = stcf_terminated,
+    .cleanup = stcf_cleanup,
+    .save = stcf_save,
+    .restore = stcf_restore,
+    .events_batch = stcf_events_batch,
+};
@@ -14,347 +14,406 @@
  * 
  *            Priority Queue Implementation for ready processes
  * 
+ * Indexed 4-ary min-heap of pids keyed on (pass, pid).  Every pid has a
+ * stride_info entry holding its stride, its pass and its heap slot, so looking
+ * a process up is O(1) and re-keying it is O(log n).  Blocked processes keep
+ * their entry (with slot == -1), which replaces the old blocked queue.
+ * 
  **************************************************************************/
-typedef struct PQnode {
+#define HEAP_ARITY 4
+
+typedef struct {
     const struct process* proc;
     int stride;
-    int pass;
-    struct PQnode* next;
-} PQnode;
-typedef struct {
-    PQnode* head;
-} PQ;
-PQ ready_procqueue;
+    unsigned long pass;
+    int slot; // index in PQ.heap, or -1 if not ready
+} stride_info;
 
-void init_pq(PQ* pq) {
-    pq->head = NULL;
+typedef struct {
+    pid_t* heap;
+    unsigned int size;
+    unsigned int capacity;
+    stride_info* info; // array index = pid
+    unsigned int info_capacity;
+
+    // during stride_events_batch(): the process the callbacks so far would
+    // have left running, and whether the one playing now switched
+    bool_t batching;
+    pid_t batch_current;
+    bool_t batch_switched;
+} PQ; // the policy state, one per simulation
+
+static void init_pq(PQ* pq) {
+    memset(pq, 0, sizeof(PQ));
+}
+static void free_PQ(PQ* q) {
+    free(q->heap);
+    free(q->info);
+    memset(q, 0, sizeof(PQ));
 }
-void free_PQ(PQ* q) {
-    PQnode* curr = q->head;
-    while (curr != NULL) {
-        PQnode* temp = curr;
-        curr = curr->next;
-        free(temp);
+static stride_info* get_process_info(PQ* q, pid_t pid) {
+    if (pid < 0 || (unsigned int)pid >= q->info_capacity || q->info[pid].proc == NULL) {
+        return NULL;
     }
-    q->head = NULL;
+    return &q->info[pid];
 }
-void add_to_pq(PQ* q, const struct process* proc, int stride, int pass) {
-    PQnode* new_node = (PQnode*)malloc(sizeof(PQnode));
-    assert(new_node != NULL);
-
-    new_node->proc = proc;
-    new_node->stride = stride;
-    new_node->pass = pass;
-    new_node->next = NULL;
-
-    PQnode** current = &(q->head);
-    
-    while (*current != NULL) {
-        if ((*current)->pass < pass) {
-            // Current node has a lower pass value, keep traversing
-            current = &((*current)->next);
-        } else if ((*current)->pass == pass && (*current)->proc->pid < proc->pid) {
-            // Same pass value, skip all nodes with the same pass
-            
-            current = &((*current)->next);
-            
-        } else {
-            // Found a node with a higher pass value, insert before it
-            break;
+static stride_info* add_process_info(PQ* q, const struct process* proc, int stride) {
+    if ((unsigned int)proc->pid >= q->info_capacity) {
+        unsigned int new_capacity = (q->info_capacity == 0) ? 64 : q->info_capacity;
+        while (new_capacity <= (unsigned int)proc->pid) {
+            new_capacity *= 2;
         }
+        q->info = realloc(q->info, new_capacity * sizeof(stride_info));
+        assert(q->info != NULL);
+        memset(&q->info[q->info_capacity], 0, (new_capacity - q->info_capacity) * sizeof(stride_info));
+        q->info_capacity = new_capacity;
     }
-   
-    new_node->next = *current;
-    *current = new_node;
-    /*PQnode** same = NULL;
+    stride_info* info = &q->info[proc->pid];
+    info->proc = proc;
+    info->stride = stride;
+    info->pass = 0;
+    info->slot = -1;
+    return info;
+}
 
-    while (*curr != NULL) {
-        if ((*curr)->pass > pass) {
+static int pq_before(PQ* q, pid_t a, pid_t b) {
+    if (q->info[a].pass != q->info[b].pass) {
+        return q->info[a].pass < q->info[b].pass;
+    }
+    return a < b;
+}
+static void pq_place(PQ* q, pid_t pid, unsigned int slot) {
+    q->heap[slot] = pid;
+    q->info[pid].slot = slot;
+}
+static void pq_sift_up(PQ* q, unsigned int slot) {
+    pid_t pid = q->heap[slot];
+    while (slot > 0) {
+        unsigned int parent = (slot - 1) / HEAP_ARITY;
+        if (!pq_before(q, pid, q->heap[parent])) {
             break;
-        } else if ((*curr)->pass == pass) {
-            same = curr;
         }
-        curr = &((*curr)->next);
+        pq_place(q, q->heap[parent], slot);
+        slot = parent;
     }
-    if (same != NULL) {
-        new_node->next = (*same)->next;
-        (*same)->next = new_node;
-    } else {
-        new_node->next = *curr;
-        *curr = new_node;
-    }*/
+    pq_place(q, pid, slot);
 }
-void remove_from_pq(PQ* q, const struct process* proc) {
-    PQnode** curr = &(q->head);
-    while(*curr != NULL && (*curr)->proc->pid != proc->pid) {
-        curr = &((*curr)->next);
+static void pq_sift_down(PQ* q, unsigned int slot) {
+    pid_t pid = q->heap[slot];
+    for (;;) {
+        unsigned int first = slot * HEAP_ARITY + 1;
+        if (first >= q->size) {
+            break;
+        }
+        unsigned int best = first;
+        for (unsigned int child = first + 1; child < first + HEAP_ARITY && child < q->size; ++child) {
+            if (pq_before(q, q->heap[child], q->heap[best])) {
+                best = child;
+            }
+        }
+        if (!pq_before(q, q->heap[best], pid)) {
+            break;
+        }
+        pq_place(q, q->heap[best], slot);
+        slot = best;
     }
-    if (*curr != NULL) {
-        PQnode* temp = *curr;
-        *curr = (*curr)->next;
-        free(temp);
+    pq_place(q, pid, slot);
+}
+
+/* adds a process (which must have stride_info) to the ready heap with the given pass */
+static void add_to_pq(PQ* q, const struct process* proc, unsigned long pass) {
+    stride_info* info = get_process_info(q, proc->pid);
+    assert(info != NULL && info->slot == -1);
+    if (q->size == q->capacity) {
+        q->capacity = (q->capacity == 0) ? 64 : 2 * q->capacity;
+        q->heap = realloc(q->heap, q->capacity * sizeof(pid_t));
+        assert(q->heap != NULL);
     }
+    info->pass = pass;
+    pq_place(q, proc->pid, q->size++);
+    pq_sift_up(q, info->slot);
 }
-PQnode* get_process_node(PQ* q, pid_t pid) {
-    if (q->head == NULL) {
-        //printf("head null\n");
-        return NULL;
+static void remove_from_pq(PQ* q, const struct process* proc) {
+    stride_info* info = get_process_info(q, proc->pid);
+    if (info == NULL || info->slot == -1) {
+        return;
     }
-    PQnode* current = q->head;
-    while (current != NULL && current->proc->pid != pid) {
-        current = current->next;
+    unsigned int slot = info->slot;
+    info->slot = -1;
+    --q->size;
+    if (slot == q->size) {
+        return;
     }
-    if (current != NULL) {
-        //printf("in\n");
-        return current;
+    pq_place(q, q->heap[q->size], slot);
+    if (slot > 0 && pq_before(q, q->heap[slot], q->heap[(slot - 1) / HEAP_ARITY])) {
+        pq_sift_up(q, slot);
+    } else {
+        pq_sift_down(q, slot);
     }
-    //printf("end\n");
-    return NULL;
-
 }
-
-/*************************************************************************
- * 
- * BlockedQueue Implementation for blocked processes
- * 
- * ************************************************************************/
-typedef struct BQNode {
-    const struct process* proc;
-    struct BQNode* next;
-    int p_stride;
-    int p_pass;
-} BQNode;
-typedef struct {
-    BQNode* front;
-    BQNode* back;
-} BQ;
-BQ blocked_procqueue;
-
-void init_bq(BQ* bq) {
-    bq->front = NULL;
-    bq->back = NULL;
-}
-void enqueue(BQ* bq, const struct process* proc, int p_stride, int p_pass) {
-    BQNode* new_node = (BQNode*)malloc(sizeof(BQNode));
-    assert(new_node != NULL);
-
-    new_node->proc = proc;
-    new_node->next = NULL;
-    new_node->p_stride = p_stride;
-    new_node->p_pass = p_pass;
-
-    if (bq->back == NULL) {
-        bq->front = new_node;
-        bq->back = new_node;
+/* moves a ready process to a new pass value */
+static void update_pass(PQ* q, const struct process* proc, unsigned long pass) {
+    stride_info* info = get_process_info(q, proc->pid);
+    assert(info != NULL && info->slot != -1);
+    unsigned long old_pass = info->pass;
+    info->pass = pass;
+    if (pass < old_pass) {
+        pq_sift_up(q, info->slot);
     } else {
-        bq->back->next = new_node;
-        bq->back = new_node;
+        pq_sift_down(q, info->slot);
+    }
+}
+static const struct process* get_top_process(PQ* q) {
+    if (q->size == 0) {
+        return NULL;
     }
+    return q->info[q->heap[0]].proc;
 }
-void dequeue_process(BQ* bq, const struct process* proc) {
-    BQNode** current = &(bq->front);
-    while (*current != NULL && (*current)->proc != proc) {
-        current = &((*current)->next);
+/* writes every known process's stride and pass, then the heap in slot order */
+static void save_PQ(PQ* q, FILE* file) {
+    unsigned int num_known = 0;
+    for (unsigned int pid = 0; pid < q->info_capacity; ++pid) {
+        num_known += (q->info[pid].proc != NULL);
     }
-    if (*current != NULL) {
-        BQNode* temp = *current;
-        *current = (*current)->next;
-        if (bq->front == NULL) {
-            bq->back = NULL;
+    fwrite(&num_known, sizeof(num_known), 1, file);
+    for (pid_t pid = 0; (unsigned int)pid < q->info_capacity; ++pid) {
+        if (q->info[pid].proc != NULL) {
+            fwrite(&pid, sizeof(pid), 1, file);
+            fwrite(&q->info[pid].stride, sizeof(int), 1, file);
+            fwrite(&q->info[pid].pass, sizeof(unsigned long), 1, file);
         }
-        free(temp);
-
     }
+    fwrite(&q->size, sizeof(q->size), 1, file);
+    fwrite(q->heap, sizeof(pid_t), q->size, file);
 }
-void free_bq(BQ* bq) {
-    BQNode* current = bq->front;
-    while (current != NULL) {
-        BQNode* temp = current;
-        current = current->next;
-        free(temp);
+/* reads back what save_PQ() wrote; in slot order, no heap entry moves when it
+ * is added; returns -1 if it does not fit */
+static int restore_PQ(PQ* q, FILE* file) {
+    unsigned int num_known;
+    if (fread(&num_known, sizeof(num_known), 1, file) != 1) {
+        return -1;
     }
-    bq->front = NULL;
-    bq->back = NULL;
-}
-BQNode* get_blocked_node(BQ* q, pid_t pid) {
-    if (q->front == NULL) {
-        return NULL;
+    for (unsigned int i = 0; i < num_known; ++i) {
+        pid_t pid;
+        int stride;
+        unsigned long pass;
+        if (fread(&pid, sizeof(pid), 1, file) != 1 || fread(&stride, sizeof(stride), 1, file) != 1 ||
+            fread(&pass, sizeof(pass), 1, file) != 1) {
+            return -1;
+        }
+        const struct process* proc = get_process(pid);
+        if (proc == NULL || get_process_info(q, pid) != NULL) {
+            return -1;
+        }
+        add_process_info(q, proc, stride)->pass = pass;
     }
-    BQNode* current = q->front;
-    while (current != NULL && current->proc->pid != pid) {
-        current = current->next;
+    unsigned int size;
+    if (fread(&size, sizeof(size), 1, file) != 1) {
+        return -1;
     }
-    if (current != NULL) {
-        return current;
+    for (unsigned int slot = 0; slot < size; ++slot) {
+        pid_t pid;
+        if (fread(&pid, sizeof(pid), 1, file) != 1) {
+            return -1;
+        }
+        stride_info* info = get_process_info(q, pid);
+        if (info == NULL || info->slot != -1) {
+            return -1;
+        }
+        add_to_pq(q, info->proc, info->pass);
     }
-    return NULL;
-
+    return 0;
 }
+
 /*************************************************************************
  * 
  *                  STRIDE Scheduler Implementation
  * 
  * ************************************************************************/
-/* sched_init
- *   will be called exactly once before any processes arrive or any other events
+/* print_ready_queue
+ *   prints the ready processes in heap order (the first line is the next to run)
  */
+#ifdef DEBUG
+static void print_ready_queue(PQ* q) {
+    for (unsigned int slot = 0; slot < q->size; ++slot) {
+        const stride_info* info = &q->info[q->heap[slot]];
+        printf("Process pid: %d, Process state: %d, Process stride: %d, Process pass: %lu\n", info->proc->pid, info->proc->state, info->stride, info->pass);
+    }
+}
+#endif // DEBUG
+
+/* tickets_of
+ *   a process's tickets, where 0 counts as 1 (the least a process can hold)
+ */
+static unsigned int tickets_of(const struct process* proc) {
+    return (proc->tickets > 0) ? proc->tickets : 1;
+}
+
 
- void print_ready_queue(PQ* q) {
-    if (q->head == NULL) {
+/* current_proc
+ *   the running process, as the callbacks see it: during a batch, the one the
+ *   callbacks so far would have left running
+ */
+static pid_t current_proc(PQ* q) {
+    return q->batching ? q->batch_current : get_current_proc();
+}
+
+
+/* switch_to
+ *   context_switch(), or during a batch, notes that the callback would have
+ *   (the simulator still hears of a process that is not READY, to refuse it
+ *   as it would have)
+ */
+static void switch_to(PQ* q, pid_t pid) {
+    if (!q->batching || get_process(pid)->state != READY) {
+        context_switch(pid);
         return;
     }
-    PQnode* current = q->head;
-    while (current != NULL) {
-        printf("Process pid: %d, Process state: %d, Process stride: %d, Process pass: %d\n", current->proc->pid, current->proc->state, current->stride, current->pass);
-        current = current->next;
-        
-    }
-   
+    q->batch_current = pid;
+    q->batch_switched = TRUE;
 }
-void sched_init() {
+
+
+/* stride_init
+ *   will be called exactly once before any processes arrive or any other events
+ */
+static void* stride_init(const char* params) {
+    (void)params; // takes none
     use_time_slice(TRUE);
-    init_pq(&ready_procqueue);
-    init_bq(&blocked_procqueue);    
+    PQ* ready_procqueue = malloc(sizeof(PQ));
+    assert(ready_procqueue != NULL);
+    init_pq(ready_procqueue);
+    return ready_procqueue;
 }
 
 
-/* sched_new_process
+/* stride_new_process
  *   will be called when a new process arrives (i.e., fork())
  *
  * proc - the new process that just arrived
  */
-void sched_new_process(const struct process* proc) {
+static void stride_new_process(void* state, int cpu, const struct process* proc) {
     assert(READY == proc->state);
+    (void)cpu; // single CPU
+    PQ* ready_procqueue = state;
 
-    int stride_val = STRIDE_CONSTANT / proc->tickets;
+    int stride_val = STRIDE_CONSTANT / tickets_of(proc);
 
-    add_to_pq(&ready_procqueue, proc, stride_val, 0);
+    add_process_info(ready_procqueue, proc, stride_val);
+    add_to_pq(ready_procqueue, proc, 0);
 
     /*get current running process*/
-    pid_t curr = get_current_proc();
+    pid_t curr = current_proc(ready_procqueue);
 
-    /*get node on top of PQ*/
-    PQnode* top = (&ready_procqueue)->head;
+    /*get process on top of PQ*/
+    const struct process* top = get_top_process(ready_procqueue);
 
-    /**if the top node on PQ is not the current running process,
+    /**if the top process on PQ is not the current running process,
      * and (top process is READY and cpu is idle)
     */
-    if (curr != top->proc->pid) {
-        if (curr == -1 && top->proc->state == READY && top->proc->pid != get_current_proc()) {
-           context_switch(top->proc->pid); 
+    if (curr != top->pid) {
+        if (curr == -1 && top->state == READY) {
+           switch_to(ready_procqueue, top->pid); 
         }        
     }
     
 }
 
 
-/* sched_finished_time_slice
+/* stride_finished_time_slice
  *   will be called when the currently running process finished a time slice
  *   (This is only called when the time slice ends with time remaining in the
  *   current CPU burst.  If finishing the time slice happens at the same time
  *   that the process blocks / terminates,
- *   then sched_blocked() / sched_terminated() will be called instead).
+ *   then stride_blocked() / stride_terminated() will be called instead).
  *
  * proc - the process whose time slice just ended
  *
  * Note: Time slice end events only occur if use_time_slice() is set to TRUE
  */
-void sched_finished_time_slice(const struct process* proc) {
+static void stride_finished_time_slice(void* state, int cpu, const struct process* proc) {
     assert(READY == proc->state);
+    (void)cpu; // single CPU
+    PQ* ready_procqueue = state;
 
-    PQnode* node = get_process_node(&ready_procqueue, proc->pid);
-    int node_pass = node->pass;
-    int node_stride = node->stride;
-
-    remove_from_pq(&ready_procqueue, proc);
- 
-    node_pass += node_stride;
+    stride_info* info = get_process_info(ready_procqueue, proc->pid);
+    if (info == NULL || info->slot == -1) {
+        return;
+    }
 
-    add_to_pq(&ready_procqueue, proc, node_stride, node_pass);
+    update_pass(ready_procqueue, proc, info->pass + info->stride);
 
-    /*get node on top of PQ*/
-    PQnode* top = (&ready_procqueue)->head;
-    if (top->proc->pid != get_current_proc()){
-        context_switch(top->proc->pid);
+    /*get process on top of PQ*/
+    const struct process* top = get_top_process(ready_procqueue);
+    if (top->pid != current_proc(ready_procqueue)){
+        switch_to(ready_procqueue, top->pid);
     }
  
 }
 
 
-/* sched_blocked
+/* stride_blocked
  *   will be called when the currently running process blocks
  *   (e.g., if it starts an I/O operation that it needs to wait to finish
  *
  * proc - the process that just blocked
  */
-void sched_blocked(const struct process* proc) {
+static void stride_blocked(void* state, int cpu, const struct process* proc) {
     assert(BLOCKED == proc->state);
+    (void)cpu; // single CPU
+    PQ* ready_procqueue = state;
 
-    //printf("Blocking: %d, State: %d\n", proc->pid, proc->state);
-
-    PQnode* node = get_process_node(&ready_procqueue, proc->pid);
-    PQnode* nxt_node = NULL;
-    if (node->next != NULL){
-        nxt_node = node->next;
+    stride_info* info = get_process_info(ready_procqueue, proc->pid);
+    if (info == NULL || info->slot == -1) {
+        return;
     }
 
-    enqueue(&blocked_procqueue, proc, node->stride, node->pass + node->stride);
-
-    remove_from_pq(&ready_procqueue, proc);
+    /*the blocked process keeps its stride and is charged for the slice it used*/
+    remove_from_pq(ready_procqueue, proc);
+    info->pass += info->stride;
 
-    /*get node on top of PQ*/
-    PQnode* top = (&ready_procqueue)->head;
-
-
-    //if next process in queue is available, context switch to it
-    //if not then switch to top process in the queue
-    if (nxt_node == NULL && top != NULL){
-        if (top->proc->pid != get_current_proc()){
-            context_switch(top->proc->pid);
-        }
-    }else if (nxt_node != NULL) {
-        if (nxt_node->proc->pid != get_current_proc()){
-           context_switch(nxt_node->proc->pid); 
-        }
-        
+    /*switch to the process with the lowest pass*/
+    const struct process* top = get_top_process(ready_procqueue);
+    if (top != NULL && top->pid != current_proc(ready_procqueue)){
+        switch_to(ready_procqueue, top->pid);
     }
 }
 
 
-/* sched_unblocked
+/* stride_unblocked
  *   will be called when a blocked process unblocks
  *   (e.g., if its I/O operation finished)
  *
  * proc - the process that just unblocked
  */
-void sched_unblocked(const struct process* proc) {
+static void stride_unblocked(void* state, int cpu, const struct process* proc) {
     assert(READY == proc->state);
+    (void)cpu; // single CPU
+    PQ* ready_procqueue = state;
 
-    BQNode* node = get_blocked_node(&blocked_procqueue, proc->pid);
-    if (node == NULL) return;
-
-    add_to_pq(&ready_procqueue, proc, node->p_stride, node->p_pass);
+    stride_info* info = get_process_info(ready_procqueue, proc->pid);
+    if (info == NULL || info->slot != -1) return;
 
-    dequeue_process(&blocked_procqueue, proc);
+    add_to_pq(ready_procqueue, proc, info->pass);
 
     /*get current running process*/
-    pid_t curr = get_current_proc();
+    pid_t curr = current_proc(ready_procqueue);
 
-    /*get node on top of PQ*/
-    PQnode* top = (&ready_procqueue)->head;
+    /*get process on top of PQ*/
+    const struct process* top = get_top_process(ready_procqueue);
 
-    /**if the top node on PQ is not the current running process,
+    /**if the top process on PQ is not the current running process,
      * and (top process is READY and cpu is idle)
     */
-    if (curr != top->proc->pid) {
-        if (curr == -1 && top->proc->state == READY && top->proc->pid != get_current_proc()) {
-           context_switch(top->proc->pid); 
+    if (curr != top->pid) {
+        if (curr == -1 && top->state == READY) {
+           switch_to(ready_procqueue, top->pid); 
         }        
     }
 }
 
 
-/* sched_terminated
+/* stride_terminated
  *   will be called when the currently running process terminates
  *   (i.e., it finished it's last CPU burst)
  *
@@ -364,32 +423,129 @@ void sched_unblocked(const struct process* proc) {
  *       currently running are not being simulated, so only the currently running
  *       process can actually terminate.
  */
-void sched_terminated(const struct process* proc) {
+static void stride_terminated(void* state, int cpu, const struct process* proc) {
     assert(TERMINATED == proc->state);
+    (void)cpu; // single CPU
+    PQ* ready_procqueue = state;
         
-    remove_from_pq(&ready_procqueue, proc);
+    remove_from_pq(ready_procqueue, proc);
 
-    PQnode* top = (&ready_procqueue)->head;
+    const struct process* top = get_top_process(ready_procqueue);
 
-    if (top != NULL && top->proc->pid != get_current_proc()){
-        context_switch(top->proc->pid); 
+    if (top != NULL && top->pid != current_proc(ready_procqueue)){
+        switch_to(ready_procqueue, top->pid); 
     }
     
 }
 
 
-/* sched_cleanup
+/* stride_events_batch
+ *   will be called instead of the callbacks above with every event at the
+ *   current time, when the simulation batches events
+ *
+ * events - the events, in the order the callbacks would have been called;
+ *          each gets CPU 0 if its callback would have switched
+ *
+ * Note: the callbacks play the events through against what they would have
+ *       left running by then; only the last switch actually happens (a
+ *       process switched away from and back to starts over, as it would have)
+ */
+static void stride_events_batch(void* state, struct sched_event* events, unsigned int num_events) {
+    PQ* ready_procqueue = state;
+    pid_t running = get_current_proc();
+    bool_t switched = FALSE;
+    ready_procqueue->batch_current = running;
+    ready_procqueue->batching = TRUE;
+    for (unsigned int i = 0; i < num_events; ++i) {
+        ready_procqueue->batch_switched = FALSE;
+        switch (events[i].type) {
+        case SCHED_NEW_PROCESS:
+            stride_new_process(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_FINISHED_TIME_SLICE:
+            stride_finished_time_slice(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_BLOCKED:
+            stride_blocked(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_UNBLOCKED:
+            stride_unblocked(state, events[i].cpu, events[i].proc);
+            break;
+        case SCHED_TERMINATED:
+            stride_terminated(state, events[i].cpu, events[i].proc);
+            break;
+        }
+        if (ready_procqueue->batch_switched) {
+            events[i].switched = 0;
+            switched = TRUE;
+        }
+        pid_t current = ready_procqueue->batch_current;
+        if (events[i].idles_stopped && current != -1 && get_process(current)->state != READY) {
+            ready_procqueue->batch_current = -1;
+        }
+    }
+    ready_procqueue->batching = FALSE;
+
+    pid_t current = ready_procqueue->batch_current;
+    if (current != -1 && switched) {
+        if (current == running) {
+            context_switch_idle(0);
+        }
+        context_switch(current);
+    }
+}
+
+
+/* stride_cleanup
  *   will be called exactly once after all processes have terminated and there
  *   are no more events left to occur, just before the simulation exits
  *
- * Note: Calling sched_cleanup() is guaranteed if the simulation has a normal exit
+ * Note: Calling stride_cleanup() is guaranteed if the simulation has a normal exit
  *       but is not guaranteed in the case of fatal errors, crashes, or other
  *       abnormal exits.
  */
-void sched_cleanup() {
-  // TODO: implement this
-   free_PQ(&ready_procqueue);
-   free_bq(&blocked_procqueue);
-    
+static void stride_cleanup(void* state) {
+    PQ* ready_procqueue = state;
+    free_PQ(ready_procqueue);
+    free(ready_procqueue);
 }
 
+
+/* stride_save
+ *   writes every process's stride and pass and the ready queue
+ */
+static void stride_save(void* state, FILE* file) {
+    save_PQ(state, file);
+}
+
+
+/* stride_restore
+ *   rebuilds what stride_save() wrote
+ */
+static void* stride_restore(const char* params, FILE* file) {
+    (void)params; // takes none
+    PQ* ready_procqueue = malloc(sizeof(PQ));
+    assert(ready_procqueue != NULL);
+    init_pq(ready_procqueue);
+    if (restore_PQ(ready_procqueue, file) != 0) {
+        stride_cleanup(ready_procqueue);
+        return NULL;
+    }
+    return ready_procqueue;
+}
+
+
+const struct sched_policy stride_policy = {
+    .name = "stride",
+    .multi_cpu = FALSE,
+    .init = stride_init,
+    .new_process = stride_new_process,
+    .finished_time_slice = stride_finished_time_slice,
+    .blocked = stride_blocked,
+    .unblocked = stride_unblocked,
+    .terminated = stride_terminated,
+    .cleanup = stride_cleanup,
+    .save = stride_save,
+    .restore = stride_restore,
+    .events_batch = stride_events_batch,
+};
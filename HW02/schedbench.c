@@ -0,0 +1,288 @@
+#include "workload.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Scheduler benchmark harness.
+ *
+ * Generates (once, with workgen) a ladder of synthetic .procb workloads and
+ * runs every scheduler binary over each of them with --bench, discarding the
+ * simulation output.  For each (scheduler, size) pair it reports the wall time
+ * of the whole run, the load and event loop times the simulator measured
+ * itself, events per second of event loop, peak RSS and allocations per event,
+ * as CSV or JSON on stdout.  With --repeat=N the fastest of N runs is kept.
+ * With --metrics the schedulers also track metrics (which costs event loop
+ * time) and each row adds the mean cpu share and Jain's fairness index, so
+ * fair-share policies can be compared on overhead and fairness at once.
+ *
+ *   make bench
+ *   ./schedbench [--format=csv|json] [--sizes=N,N,...] [--repeat=N] [--seed=S]
+ *                [--dir=DIR] [--metrics] [scheduler...]
+ */
+
+#define MAX_SIZES 32
+#define DEFAULT_SIZES "1000,10000,100000"
+
+struct result {
+  double wall_seconds;
+  double load_seconds;
+  double loop_seconds;
+  unsigned long events;
+  unsigned long loop_allocations;
+  long peak_rss_kb;
+  double mean_cpu_share; // with --metrics
+  double fairness;
+};
+
+
+/* runs argv with stdout discarded and stderr captured in a temporary file;
+ * returns the child's exit status (or -1) and its resource usage */
+static int run(char* const argv[], FILE** errors, struct rusage* usage, double* wall_seconds) {
+  *errors = tmpfile();
+  if (NULL == *errors) {
+    perror("ERROR creating temporary file");
+    exit(EXIT_FAILURE);
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pid_t child = fork();
+  if (-1 == child) {
+    perror("ERROR forking");
+    exit(EXIT_FAILURE);
+  }
+  if (0 == child) {
+    int null = open("/dev/null", O_WRONLY);
+    if (-1 == null || -1 == dup2(null, STDOUT_FILENO) || -1 == dup2(fileno(*errors), STDERR_FILENO))
+      _exit(127);
+    execv(argv[0], argv);
+    fprintf(stderr, "ERROR running %s: %s\n", argv[0], strerror(errno));
+    _exit(127);
+  }
+
+  int status;
+  if (-1 == wait4(child, &status, 0, usage)) {
+    perror("ERROR waiting for child");
+    exit(EXIT_FAILURE);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  *wall_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  rewind(*errors);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void print_errors(FILE* errors) {
+  char line[1024];
+  rewind(errors);
+  while (NULL != fgets(line, sizeof(line), errors))
+    fputs(line, stderr);
+}
+
+
+/* generates the workload for one size unless it already exists; returns its
+ * number of bursts, read back from the .procb header */
+static unsigned long make_workload(const char* dir, unsigned int size, unsigned long seed, char* path, size_t path_size) {
+  snprintf(path, path_size, "%s/bench_%u_%lu.procb", dir, size, seed);
+  if (0 != access(path, R_OK)) {
+    char procs[32], seed_arg[32];
+    snprintf(procs, sizeof(procs), "--procs=%u", size);
+    snprintf(seed_arg, sizeof(seed_arg), "--seed=%lu", seed);
+    char* const argv[] = {"./workgen", procs, seed_arg, path, NULL};
+    FILE* errors;
+    struct rusage usage;
+    double wall_seconds;
+    if (0 != run(argv, &errors, &usage, &wall_seconds)) {
+      print_errors(errors);
+      fprintf(stderr, "ERROR generating %s\n", path);
+      exit(EXIT_FAILURE);
+    }
+    fclose(errors);
+  }
+
+  struct procb_header header;
+  FILE* file = fopen(path, "rb");
+  if (NULL == file || 1 != fread(&header, sizeof(header), 1, file)) {
+    fprintf(stderr, "ERROR reading %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+  fclose(file);
+  return header.num_bursts;
+}
+
+static int bench_once(const char* scheduler, const char* path, int metrics, struct result* result) {
+  char* argv[5];
+  int argc = 0;
+  argv[argc++] = (char*)scheduler;
+  argv[argc++] = "--bench";
+  if (metrics)
+    argv[argc++] = "--metrics";
+  argv[argc++] = (char*)path;
+  argv[argc] = NULL;
+  FILE* errors;
+  struct rusage usage;
+  int status = run(argv, &errors, &usage, &result->wall_seconds);
+  result->peak_rss_kb = usage.ru_maxrss;
+
+  int found = 0;
+  char line[1024];
+  while (NULL != fgets(line, sizeof(line), errors)) {
+    unsigned int procs;
+    unsigned long setup_allocations;
+    if (6 == sscanf(line, "bench: procs=%u events=%lu load_seconds=%lf loop_seconds=%lf setup_allocations=%lu loop_allocations=%lu",
+                    &procs, &result->events, &result->load_seconds, &result->loop_seconds,
+                    &setup_allocations, &result->loop_allocations))
+      found = 1;
+    sscanf(line, "  mean cpu share %lf, Jain's fairness index of cpu share per ticket %lf",
+           &result->mean_cpu_share, &result->fairness);
+  }
+  if (0 != status || !found) {
+    print_errors(errors);
+    fprintf(stderr, "ERROR: %s %s exited with status %d%s\n", scheduler, path, status,
+            found ? "" : " without printing bench results");
+    fclose(errors);
+    return -1;
+  }
+  fclose(errors);
+  return 0;
+}
+
+
+static void usage() {
+  fprintf(stderr, "Usage: ./schedbench [--format=csv|json] [--sizes=N,N,...] [--repeat=N] [--seed=S] [--dir=DIR] [--metrics] [scheduler...]\n");
+}
+
+
+int main(int argc, char** argv) {
+  static const struct option long_options[] = {
+    {"format", required_argument, NULL, 'f'},
+    {"sizes", required_argument, NULL, 'n'},
+    {"repeat", required_argument, NULL, 'r'},
+    {"seed", required_argument, NULL, 's'},
+    {"dir", required_argument, NULL, 'd'},
+    {"metrics", no_argument, NULL, 'm'},
+    {NULL, 0, NULL, 0}
+  };
+  int json = 0;
+  const char* sizes_arg = DEFAULT_SIZES;
+  unsigned int repeat = 1;
+  unsigned long seed = 1;
+  const char* dir = ".";
+  int metrics = 0;
+
+  int opt;
+  while (-1 != (opt = getopt_long(argc, argv, "", long_options, NULL))) {
+    switch (opt) {
+    case 'f':
+      if (0 == strcmp(optarg, "json")) {
+        json = 1;
+      } else if (0 != strcmp(optarg, "csv")) {
+        usage();
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'n':
+      sizes_arg = optarg;
+      break;
+    case 'r':
+      repeat = strtoul(optarg, NULL, 10);
+      break;
+    case 's':
+      seed = strtoul(optarg, NULL, 10);
+      break;
+    case 'd':
+      dir = optarg;
+      break;
+    case 'm':
+      metrics = 1;
+      break;
+    default:
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (0 == repeat) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  unsigned int sizes[MAX_SIZES];
+  unsigned int num_sizes = 0;
+  for (const char* p = sizes_arg; '\0' != *p; ) {
+    char* end;
+    unsigned long size = strtoul(p, &end, 10);
+    if (end == p || 0 == size || num_sizes == MAX_SIZES || (',' != *end && '\0' != *end)) {
+      fprintf(stderr, "ERROR: bad --sizes \"%s\"\n", sizes_arg);
+      return EXIT_FAILURE;
+    }
+    sizes[num_sizes++] = size;
+    p = (',' == *end) ? end + 1 : end;
+  }
+
+  static char* const default_schedulers[] = {"./sched_rr", "./sched_stcf", "./sched_stride"};
+  char* const* schedulers = (optind < argc) ? &argv[optind] : default_schedulers;
+  int num_schedulers = (optind < argc) ? argc - optind : 3;
+
+  if (json)
+    printf("[\n");
+  else
+    printf("scheduler,procs,bursts,events,wall_seconds,load_seconds,loop_seconds,events_per_second,peak_rss_kb,allocs_per_event%s\n",
+           metrics ? ",mean_cpu_share,fairness" : "");
+
+  int failed = 0, first = 1;
+  for (unsigned int i = 0; i < num_sizes; ++i) {
+    char path[4096];
+    unsigned long bursts = make_workload(dir, sizes[i], seed, path, sizeof(path));
+
+    for (int s = 0; s < num_schedulers; ++s) {
+      struct result best;
+      int ok = 1;
+      for (unsigned int run_index = 0; ok && run_index < repeat; ++run_index) {
+        struct result result = {0};
+        ok = (0 == bench_once(schedulers[s], path, metrics, &result));
+        if (ok && (0 == run_index || result.wall_seconds < best.wall_seconds))
+          best = result;
+      }
+      if (!ok) {
+        failed = 1;
+        continue;
+      }
+
+      double events_per_second = (best.loop_seconds > 0) ? best.events / best.loop_seconds : 0;
+      double allocs_per_event = (best.events > 0) ? (double)best.loop_allocations / best.events : 0;
+      if (json) {
+        printf("%s  {\"scheduler\": \"%s\", \"procs\": %u, \"bursts\": %lu, \"events\": %lu, "
+               "\"wall_seconds\": %.6f, \"load_seconds\": %.6f, \"loop_seconds\": %.6f, "
+               "\"events_per_second\": %.0f, \"peak_rss_kb\": %ld, \"allocs_per_event\": %.6f",
+               first ? "" : ",\n", schedulers[s], sizes[i], bursts, best.events,
+               best.wall_seconds, best.load_seconds, best.loop_seconds,
+               events_per_second, best.peak_rss_kb, allocs_per_event);
+        if (metrics)
+          printf(", \"mean_cpu_share\": %.6f, \"fairness\": %.6f", best.mean_cpu_share, best.fairness);
+        printf("}");
+      } else {
+        printf("%s,%u,%lu,%lu,%.6f,%.6f,%.6f,%.0f,%ld,%.6f",
+               schedulers[s], sizes[i], bursts, best.events,
+               best.wall_seconds, best.load_seconds, best.loop_seconds,
+               events_per_second, best.peak_rss_kb, allocs_per_event);
+        if (metrics)
+          printf(",%.6f,%.6f", best.mean_cpu_share, best.fairness);
+        printf("\n");
+      }
+      fflush(stdout);
+      first = 0;
+    }
+  }
+  if (json)
+    printf("%s]\n", first ? "" : "\n");
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,177 @@
+#ifndef _SCHEDSIM_H_
+#define _SCHEDSIM_H_
+
+#include "scheduler.h"
+#include "trace.h"
+#include "workload.h"
+#include "metrics.h"
+#include "counters.h"
+#include <stdio.h>
+
+/* libschedsim: the simulator as a library.
+ *
+ * All simulation state lives in a struct sim_ctx, so independent simulations
+ * can run at the same time on separate threads.  Each simulation runs one
+ * scheduling policy (struct sched_policy in scheduler.h), which keeps its own
+ * state; the scheduler API in scheduler.h (context_switch(),
+ * get_current_proc(), ...) acts on the simulation whose sim_run() is calling
+ * back into the policy on the current thread.
+ *
+ *   struct sim_options options;
+ *   sim_default_options(&options);
+ *   options.policy = find_sched_policy("stride");
+ *   struct sim_ctx* ctx = sim_create(&options);
+ *   sim_load_file(ctx, "workload.proc");
+ *   time_ticks_t end_time = sim_run(ctx, NULL);
+ *   sim_destroy(ctx);
+ *
+ * With options.checkpoint_every a running simulation writes checkpoints,
+ * which sim_restore_file() resumes from (as many times as needed, e.g. with
+ * different policy parameters) instead of starting the workload over.
+ */
+
+#define SIM_MAX_CPUS 4096
+
+struct sim_options {
+  const struct sched_policy* policy;
+  const char* policy_params; // "key=value:...", see struct sched_policy; NULL for defaults
+  unsigned int num_cpus;   // 1 .. SIM_MAX_CPUS
+  trace_mode_t trace_mode;
+  FILE* trace_file;        // where the trace goes; stdout if NULL
+  bool_t metrics;          // track per-process metrics (see metrics.h)
+  time_ticks_t time_slice; // overrides the workload's time slice unless 0
+  bool_t batch_events;     // hand the policy all events at one time at once (it must have events_batch())
+  time_ticks_t checkpoint_every; // checkpoint at every multiple of this many ticks, unless 0
+  const char* checkpoint_prefix; // checkpoints go to <prefix>.<time>.ckpt
+  // the cost model: a dispatch keeps the CPU busy for switch_cost ticks before
+  // the process starts, plus cache_penalty if the process is resuming on a
+  // CPU that has dispatched at least cache_window others since it last ran
+  // there (or it last ran on another CPU); all 0 for free switches
+  time_ticks_t switch_cost;
+  time_ticks_t cache_penalty;
+  unsigned int cache_window;
+};
+
+/* Where the simulator's time goes: the hot-path counters --stats reports,
+ * only kept when built with SIM_STATS (see counters.h) */
+struct sim_counters {
+  unsigned long events[NUM_EVENT_TYPES]; // popped, array index = event_type_t
+  struct sample_count insert_depth;      // see struct event_queue_stats
+  struct sample_count remove_scan;
+  unsigned long switches_requested;      // context_switch_on() calls
+  unsigned long switches_rejected;       // of those, the ones that failed
+  struct sample_count ready_length;      // READY processes waiting for a CPU, after each event
+};
+
+struct sim_stats {
+  unsigned int num_procs;          // processes in the workload
+  unsigned long num_events;        // events handled by the event loop
+  unsigned long setup_allocations; // allocations in the process before the event loop
+  unsigned long loop_allocations;  // allocations during the event loop
+  double loop_seconds;
+  unsigned long long switch_overhead; // CPU ticks spent switching (see sim_options)
+  double overhead_percent;            // of the CPU time up to the end time, on every CPU
+  struct sim_counters counters;       // all zero unless built with SIM_STATS
+};
+
+struct sim_ctx;
+
+/* sched_policies
+ *   every policy that can be simulated, NULL-terminated (see policies.c)
+ */
+extern const struct sched_policy* const sched_policies[];
+
+/* find_sched_policy
+ *   returns the policy called name, or NULL if there is none
+ */
+const struct sched_policy* find_sched_policy(const char* name);
+
+/* parse_sched_policies
+ *   parses a comma-separated list of policies, each "name" or
+ *   "name:key=value:key=value", into up to max policies and their parameters
+ *   (malloc'd copies, or NULL); returns how many, or prints why not and
+ *   returns -1 if a policy does not exist or does not take those parameters
+ */
+int parse_sched_policies(const char* list, const struct sched_policy** policies, char** params, int max);
+
+/* sim_default_options
+ *   the first of sched_policies on one CPU, text trace on stdout, no metrics,
+ *   free context switches
+ */
+void sim_default_options(struct sim_options* options);
+
+/* sim_create
+ *   creates a simulation; returns NULL (after printing why) if the policy
+ *   cannot run with these options
+ */
+struct sim_ctx* sim_create(const struct sim_options* options);
+
+/* sim_load_file
+ *   loads a .proc or .procb workload and queues its arrivals; exits with an
+ *   error message if the file cannot be loaded
+ */
+void sim_load_file(struct sim_ctx* ctx, const char* filename);
+
+/* sim_use_workload
+ *   like sim_load_file, for a workload that is already loaded; the simulation
+ *   runs it in place and frees it in sim_destroy()
+ */
+void sim_use_workload(struct sim_ctx* ctx, struct workload* workload);
+
+/* sim_stream_file
+ *   like sim_load_file, but for a workload in order of arrival: each process
+ *   is only read when the one before it arrives, and once a process has
+ *   terminated its pid, process and bursts are reused for the next one read,
+ *   so memory grows with the processes alive at once rather than with the
+ *   workload.  Pids are therefore these slots rather than workload lines.
+ *   Exits with an error message if the file cannot be read or a process
+ *   arrives before the one ahead of it; cannot be checkpointed.
+ */
+void sim_stream_file(struct sim_ctx* ctx, const char* filename);
+
+/* sim_restore_file
+ *   like sim_load_file, but resumes from a checkpoint, which must be of the
+ *   same policy on as many CPUs; the policy keeps the parameters it was
+ *   checkpointed with unless options.policy_params gives others, and the
+ *   cost model likewise unless options gives a switch_cost or cache_penalty.
+ *   Exits with an error message if the file cannot be restored.
+ */
+void sim_restore_file(struct sim_ctx* ctx, const char* filename);
+
+/* sim_checkpoint_policy
+ *   returns the policy a checkpoint was taken with, and sets *params to a
+ *   malloc'd copy of its parameters (or NULL) and *num_cpus; exits with an
+ *   error message if the file is not a checkpoint
+ */
+const struct sched_policy* sim_checkpoint_policy(const char* filename, char** params, unsigned int* num_cpus);
+
+/* sim_run
+ *   runs the loaded workload to completion with the policy and
+ *   returns the end time; fills in stats if it is not NULL
+ */
+time_ticks_t sim_run(struct sim_ctx* ctx, struct sim_stats* stats);
+
+/* sim_report_metrics
+ *   prints the metrics of a finished run (if options.metrics was set)
+ */
+void sim_report_metrics(const struct sim_ctx* ctx, FILE* file);
+
+/* sim_report_stats
+ *   prints the counters and allocations of a finished run (or that a build
+ *   without SIM_STATS did not count)
+ */
+void sim_report_stats(const struct sim_stats* stats, FILE* file);
+
+/* sim_summarize_metrics
+ *   fills in the metrics of a finished run; all zero (and fairness 1) if
+ *   options.metrics was not set
+ */
+void sim_summarize_metrics(const struct sim_ctx* ctx, struct metrics_summary* summary);
+
+/* sim_destroy
+ *   reports processes that did not finish, flushes the trace and releases
+ *   the simulation and its workload
+ */
+void sim_destroy(struct sim_ctx* ctx);
+
+#endif /* _SCHEDSIM_H_ */
@@ -0,0 +1,369 @@
+#include "schedsim.h"
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Parameter sweep driver.
+ *
+ * Loads a workload once and simulates it under every combination of the
+ * given policies, time slices and ticket scalings, printing one CSV row of summary
+ * metrics per configuration (in grid order) on stdout.  Each configuration
+ * runs in a forked child that shares the parsed workload with the parent
+ * copy-on-write, so only the pages a simulation actually changes get copied;
+ * up to --jobs children run at once.
+ *
+ * A ticket scaling S replaces each process's tickets t with t^S, rounded and
+ * kept between 1 and MAX_TICKETS: 1 keeps the workload's tickets, 0 gives
+ * every process the same share and 2 exaggerates the differences.
+ *
+ * The policies default to every policy that can run on --cpus; a policy can
+ * be given parameters as in --policy (NAME:KEY=N:KEY=N), and the same policy
+ * can be listed with several parameter sets.
+ *
+ * With --restore=FILE every configuration carries on from a checkpoint (see
+ * --checkpoint-every in main.c) instead: a warmed-up simulation forked into
+ * what-ifs.  The policy defaults to the checkpoint's, whose parameters and
+ * time slice (0) can be changed, but not its tickets.
+ *
+ * --switch-cost, --cache-penalty and --cache-window apply the simulator's
+ * cost model to every configuration, and each row reports its overhead.
+ *
+ *   ./schedsweep [--policies=NAME[:KEY=N...],...] [--time-slices=N,N,...]
+ *                [--ticket-scales=S,S,...] [--cpus=N] [--jobs=N] filename.proc
+ *   ./schedsweep [--policies=...] [--time-slices=...] [--jobs=N] --restore=FILE
+ */
+
+#define MAX_VALUES 256
+#define MAX_TICKETS 1000000 // keeps stride's STRIDE_CONSTANT / tickets above 0
+#define ROW_SIZE 512         // a row fits in one atomic pipe write
+
+struct config {
+  const struct sched_policy* policy;
+  const char* policy_params;
+  time_ticks_t time_slice;
+  double ticket_scale;
+};
+
+struct job {
+  pid_t child;
+  int pipe;               // read end, carrying the row
+  unsigned int config;    // index into configs
+};
+
+
+/* parses a comma-separated list of numbers; returns how many, or -1 */
+static int parse_list(const char* arg, double* values, int integers) {
+  int count = 0;
+  for (const char* p = arg; '\0' != *p; ) {
+    char* end;
+    double value = strtod(p, &end);
+    if (end == p || count == MAX_VALUES || (',' != *end && '\0' != *end) || value < 0 ||
+        (integers && (value != floor(value) || value > UINT32_MAX)))
+      return -1;
+    values[count++] = value;
+    p = (',' == *end) ? end + 1 : end;
+  }
+  return count;
+}
+
+
+static unsigned int scale_tickets(unsigned int tickets, double scale) {
+  double scaled = floor(pow(tickets, scale) + 0.5);
+  if (scaled < 1)
+    return 1;
+  return (scaled > MAX_TICKETS) ? MAX_TICKETS : (unsigned int)scaled;
+}
+
+
+/* runs one configuration in a forked child and writes its row to fd; the
+ * simulation runs workload, or restores the checkpoint if workload is NULL,
+ * with the cost model in costs */
+static void run_config(struct workload* workload, const char* checkpoint, const struct config* config,
+                       unsigned int num_cpus, const struct sim_options* costs, int fd) {
+  for (unsigned int pid = 0; NULL != workload && pid < workload->num_procs; ++pid)
+    workload->procs[pid].tickets = scale_tickets(workload->procs[pid].tickets, config->ticket_scale);
+
+  FILE* null = fopen("/dev/null", "w");
+  if (NULL == null) {
+    perror("ERROR opening /dev/null");
+    _exit(EXIT_FAILURE);
+  }
+  struct sim_options options;
+  sim_default_options(&options);
+  options.policy = config->policy;
+  options.policy_params = config->policy_params;
+  options.num_cpus = num_cpus;
+  options.trace_mode = TRACE_NONE;
+  options.trace_file = null;
+  options.metrics = TRUE;
+  options.time_slice = config->time_slice;
+  options.switch_cost = costs->switch_cost;
+  options.cache_penalty = costs->cache_penalty;
+  options.cache_window = costs->cache_window;
+
+  struct sim_ctx* ctx = sim_create(&options);
+  if (NULL == ctx)
+    _exit(EXIT_FAILURE);
+  if (NULL != workload)
+    sim_use_workload(ctx, workload);
+  else
+    sim_restore_file(ctx, checkpoint);
+  struct sim_stats stats;
+  time_ticks_t end_time = sim_run(ctx, &stats);
+  struct metrics_summary summary;
+  sim_summarize_metrics(ctx, &summary);
+  sim_destroy(ctx);
+
+  char row[ROW_SIZE];
+  int length = snprintf(row, sizeof(row),
+                        "%s%s%s,%u,%g,%u,%u,%lu,%u,%lu,%.6f,%.2f,%lu,"
+                        "%.1f,%llu,%llu,%.1f,%llu,%llu,%.1f,%llu,%llu,%.4f,%.4f,%llu,%.2f\n",
+                        config->policy->name, config->policy_params ? ":" : "",
+                        config->policy_params ? config->policy_params : "", config->time_slice, config->ticket_scale, num_cpus,
+                        stats.num_procs, summary.num_terminated, end_time, stats.num_events,
+                        stats.loop_seconds, summary.cpu_utilization, summary.dispatches,
+                        summary.turnaround_mean, summary.turnaround_p50, summary.turnaround_p99,
+                        summary.response_mean, summary.response_p50, summary.response_p99,
+                        summary.waiting_mean, summary.waiting_p50, summary.waiting_p99,
+                        summary.mean_cpu_share, summary.fairness,
+                        stats.switch_overhead, stats.overhead_percent);
+  if (length != write(fd, row, length))
+    _exit(EXIT_FAILURE);
+  _exit(EXIT_SUCCESS);
+}
+
+
+static void usage() {
+  fprintf(stderr, "Usage: ./schedsweep [--policies=NAME[:KEY=N...],...] [--time-slices=N,N,...] [--ticket-scales=S,S,...] [--cpus=N] [--switch-cost=TICKS] [--cache-penalty=TICKS [--cache-window=N]] [--jobs=N] filename.proc\n"
+                  "       ./schedsweep [--policies=NAME[:KEY=N...],...] [--time-slices=N,N,...] [--jobs=N] --restore=FILE\n");
+}
+
+
+int main(int argc, char** argv) {
+  static const struct option long_options[] = {
+    {"policies", required_argument, NULL, 'p'},
+    {"time-slices", required_argument, NULL, 't'},
+    {"ticket-scales", required_argument, NULL, 's'},
+    {"cpus", required_argument, NULL, 'c'},
+    {"jobs", required_argument, NULL, 'j'},
+    {"restore", required_argument, NULL, 'r'},
+    {"switch-cost", required_argument, NULL, 'w'},
+    {"cache-penalty", required_argument, NULL, 'e'},
+    {"cache-window", required_argument, NULL, 'n'},
+    {NULL, 0, NULL, 0}
+  };
+  const char* policies_arg = NULL;
+  const char* restore = NULL;
+  const struct sched_policy* policies[MAX_VALUES];
+  char* params[MAX_VALUES] = {NULL};
+  double time_slices[MAX_VALUES], ticket_scales[MAX_VALUES] = {1};
+  int num_policies = 0, num_time_slices = 0, num_ticket_scales = 1;
+  unsigned long num_cpus = 0; // 1 unless --cpus, or the checkpoint's
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  struct sim_options costs;
+  sim_default_options(&costs);
+
+  int opt;
+  while (-1 != (opt = getopt_long(argc, argv, "", long_options, NULL))) {
+    switch (opt) {
+    case 'p':
+      policies_arg = optarg;
+      break;
+    case 't':
+      num_time_slices = parse_list(optarg, time_slices, 1);
+      if (num_time_slices <= 0) {
+        fprintf(stderr, "ERROR: bad --time-slices \"%s\"\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 's':
+      num_ticket_scales = parse_list(optarg, ticket_scales, 0);
+      if (num_ticket_scales <= 0) {
+        fprintf(stderr, "ERROR: bad --ticket-scales \"%s\"\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'c':
+      num_cpus = strtoul(optarg, NULL, 10);
+      if (0 == num_cpus || num_cpus > SIM_MAX_CPUS) {
+        fprintf(stderr, "ERROR: --cpus must be between 1 and %d\n", SIM_MAX_CPUS);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'j':
+      jobs = strtol(optarg, NULL, 10);
+      break;
+    case 'r':
+      restore = optarg;
+      break;
+    case 'w':
+      costs.switch_cost = strtoul(optarg, NULL, 10);
+      break;
+    case 'e':
+      costs.cache_penalty = strtoul(optarg, NULL, 10);
+      break;
+    case 'n':
+      costs.cache_window = strtoul(optarg, NULL, 10);
+      if (0 == costs.cache_window) {
+        fprintf(stderr, "ERROR: --cache-window must be a positive number of dispatches\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (optind + (NULL == restore) != argc || jobs < 1) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  const struct sched_policy* checkpoint_policy = NULL;
+  char* checkpoint_params = NULL;
+  if (NULL != restore) {
+    unsigned int checkpoint_cpus;
+    checkpoint_policy = sim_checkpoint_policy(restore, &checkpoint_params, &checkpoint_cpus);
+    if (0 != num_cpus && num_cpus != checkpoint_cpus) {
+      fprintf(stderr, "ERROR: %s was checkpointed on %u CPUs, not %lu\n", restore, checkpoint_cpus, num_cpus);
+      return EXIT_FAILURE;
+    }
+    num_cpus = checkpoint_cpus;
+    if (1 != num_ticket_scales || 1 != ticket_scales[0]) {
+      fprintf(stderr, "ERROR: --ticket-scales cannot rescale a checkpoint\n");
+      return EXIT_FAILURE;
+    }
+  } else if (0 == num_cpus) {
+    num_cpus = 1;
+  }
+
+  if (NULL != restore && NULL == policies_arg) {
+    policies[0] = checkpoint_policy;
+    params[0] = checkpoint_params;
+    checkpoint_params = NULL;
+    num_policies = 1;
+  } else if (NULL == policies_arg) {
+    for (unsigned int i = 0; NULL != sched_policies[i]; ++i) {
+      if (sched_policies[i]->multi_cpu || 1 == num_cpus)
+        policies[num_policies++] = sched_policies[i];
+    }
+  } else {
+    num_policies = parse_sched_policies(policies_arg, policies, params, MAX_VALUES);
+    if (num_policies < 0)
+      return EXIT_FAILURE;
+    for (int p = 0; p < num_policies; ++p) {
+      if (!policies[p]->multi_cpu && num_cpus > 1) {
+        fprintf(stderr, "ERROR: the %s policy only runs on one CPU\n", policies[p]->name);
+        return EXIT_FAILURE;
+      }
+      if (NULL != restore && policies[p] != checkpoint_policy) {
+        fprintf(stderr, "ERROR: %s is a checkpoint of the %s policy, not %s\n",
+                restore, checkpoint_policy->name, policies[p]->name);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  free(checkpoint_params);
+
+  struct workload workload;
+  if (NULL == restore)
+    load_workload(argv[optind], &workload);
+  if (0 == num_time_slices) {
+    // a checkpoint keeps its own time slice (0 overrides nothing)
+    time_slices[0] = (NULL == restore) ? workload.time_slice : 0;
+    num_time_slices = 1;
+  }
+
+  unsigned int num_configs = num_policies * num_time_slices * num_ticket_scales;
+  struct config* configs = malloc(num_configs * sizeof(struct config));
+  char* rows = calloc(num_configs, ROW_SIZE);
+  struct job* running = malloc(jobs * sizeof(struct job));
+  if (NULL == configs || NULL == rows || NULL == running) {
+    perror("ERROR allocating the sweep");
+    return EXIT_FAILURE;
+  }
+  struct config* config = configs;
+  for (int p = 0; p < num_policies; ++p) {
+    for (int t = 0; t < num_time_slices; ++t) {
+      for (int s = 0; s < num_ticket_scales; ++s, ++config) {
+        config->policy = policies[p];
+        config->policy_params = params[p];
+        config->time_slice = time_slices[t];
+        config->ticket_scale = ticket_scales[s];
+      }
+    }
+  }
+
+  int failed = 0;
+  unsigned int next = 0;
+  long num_running = 0;
+  while (next < num_configs || num_running > 0) {
+    // keep up to jobs children busy
+    while (next < num_configs && num_running < jobs) {
+      int fds[2];
+      if (-1 == pipe(fds)) {
+        perror("ERROR creating pipe");
+        return EXIT_FAILURE;
+      }
+      pid_t child = fork();
+      if (-1 == child) {
+        perror("ERROR forking");
+        return EXIT_FAILURE;
+      }
+      if (0 == child) {
+        close(fds[0]);
+        run_config((NULL == restore) ? &workload : NULL, restore, &configs[next], num_cpus, &costs, fds[1]);
+      }
+      close(fds[1]);
+      running[num_running++] = (struct job){child, fds[0], next++};
+    }
+
+    int status;
+    pid_t child = wait(&status);
+    if (-1 == child) {
+      perror("ERROR waiting for child");
+      return EXIT_FAILURE;
+    }
+    for (long i = 0; i < num_running; ++i) {
+      if (running[i].child != child)
+        continue;
+      struct job job = running[i];
+      running[i] = running[--num_running];
+
+      char* row = &rows[job.config * ROW_SIZE];
+      ssize_t length = read(job.pipe, row, ROW_SIZE - 1);
+      close(job.pipe);
+      if (!WIFEXITED(status) || EXIT_SUCCESS != WEXITSTATUS(status) || length <= 0) {
+        fprintf(stderr, "ERROR: %s%s%s with time slice %u, ticket scale %g failed\n",
+                configs[job.config].policy->name, configs[job.config].policy_params ? ":" : "",
+                configs[job.config].policy_params ? configs[job.config].policy_params : "",
+                configs[job.config].time_slice,
+                configs[job.config].ticket_scale);
+        row[0] = '\0';
+        failed = 1;
+      }
+      break;
+    }
+  }
+
+  printf("policy,time_slice,ticket_scale,cpus,procs,terminated,end_time,events,loop_seconds,"
+         "cpu_utilization,dispatches,turnaround_mean,turnaround_p50,turnaround_p99,"
+         "response_mean,response_p50,response_p99,waiting_mean,waiting_p50,waiting_p99,"
+         "mean_cpu_share,fairness,switch_overhead,overhead_percent\n");
+  for (unsigned int i = 0; i < num_configs; ++i)
+    fputs(&rows[i * ROW_SIZE], stdout);
+
+  free(running);
+  free(rows);
+  free(configs);
+  for (int p = 0; p < num_policies; ++p)
+    free(params[p]);
+  if (NULL == restore)
+    free_workload(&workload);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
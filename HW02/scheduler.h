@@ -2,77 +2,163 @@
 #define _SCHEDULER_H_
 
 #include "process.h"
+#include <stdio.h>
 
-/*****************************
- * Implement These Functions *
- *****************************/
+/* since C doesn't have a native boolean type, we made one */
+typedef enum {FALSE=0, TRUE=1} bool_t;
 
-/* sched_init
- *   will be called exactly once before any processes arrive or any other events
- */
-void sched_init();
 
-/* sched_new_process
- *   will be called when a new process arrives (i.e., fork())
+/*********************************
+ * Implement A Scheduling Policy *
+ *********************************/
+
+/* One of the events events_batch() gets: which event callback it stands for,
+ * and that callback's arguments */
+typedef enum {SCHED_NEW_PROCESS, SCHED_FINISHED_TIME_SLICE, SCHED_BLOCKED, SCHED_UNBLOCKED, SCHED_TERMINATED} sched_event_type_t;
+
+struct sched_event {
+  sched_event_type_t type;
+  int cpu;
+  const struct process* proc;
+  int switched; // -1, or the CPU the callback would have switched (events_batch() sets it)
+  bool_t idles_stopped; // the simulator would idle every CPU whose process is not READY after this event
+};
+
+/* A scheduling policy is a table of callbacks.  init() creates the policy's
+ * private state for one simulation, every other callback gets that state
+ * back, so several simulations (or several policies) can run at once.
  *
- * proc - the new process that just arrived
- */
-void sched_new_process(const struct process* proc);
-
-/* sched_finished_time_slice
- *   will be called when the currently running process finished a time slice
- *   (This is only called when the time slice ends with time remaining in the
- *   current CPU burst.  If finishing the time slice happens at the same time
- *   that the process blocks / terminates,
- *   then sched_blocked() / sched_terminated() will be called instead).
+ * The event callbacks take the CPU the event came from:
+ *   - finished_time_slice, blocked, terminated: the CPU the process was
+ *     running on
+ *   - unblocked: the CPU the process last ran on
+ *   - new_process: -1 (the process has not run anywhere yet)
+ * A policy that is not multi_cpu only ever sees CPU 0 (or -1) and can use
+ * context_switch() and get_current_proc().
  *
- * proc - the process whose time slice just ended
+ * A policy can take numeric parameters, given on the command line as
+ * --policy=name:key=value:key=value; init() gets the "key=value:..." part
+ * (or NULL) and reads it with get_policy_param().
  *
- * Note: Time slice end events only occur if use_time_slice() is set to TRUE
- */
-void sched_finished_time_slice(const struct process* proc);
-
-/* sched_blocked
- *   will be called when the currently running process blocks
- *   (e.g., if it starts an I/O operation that it needs to wait to finish
+ * A policy with save() and restore() can be checkpointed: save() writes
+ * whatever the policy needs to carry on from this point, and restore() is
+ * called instead of init() when a simulation resumes from the checkpoint.
  *
- * proc - the process that just blocked
- */
-void sched_blocked(const struct process* proc);
-
-/* sched_unblocked
- *   will be called when a blocked process unblocks
- *   (e.g., if its I/O operation finished)
+ * A policy with events_batch() can take the events of one time all at once,
+ * when the simulation batches them (sim_options.batch_events): it gets them
+ * in the order the event callbacks would have, and switches each CPU at most
+ * once, at the end, instead of after each.  Only such a policy can be run
+ * with batching.
  *
- * proc - the process that just unblocked
+ * To add a policy, define its struct sched_policy and list it in policies.c.
  */
-void sched_unblocked(const struct process* proc);
+struct sched_policy {
+  const char* name;  // what --policy selects it by
+  bool_t multi_cpu;  // whether it can be simulated with more than one CPU
+  const char* const* params; // the parameter keys init() accepts, NULL-terminated (or NULL)
 
-/* sched_terminated
- *   will be called when the currently running process terminates
- *   (i.e., it finished it's last CPU burst)
- *
- * proc - the process that just terminated
- *
- * Note: "kill" commands and other ways to terminate a process that is not
- *       currently running are not being simulated, so only the currently running
- *       process can actually terminate.
- */
-void sched_terminated(const struct process* proc);
+  /* init
+   *   will be called exactly once before any processes arrive or any other
+   *   events; returns the policy's state for this simulation
+   *
+   * params - the policy's parameters, or NULL
+   */
+  void* (*init)(const char* params);
 
-/* sched_cleanup
- *   will be called exactly once after all processes have terminated and there
- *   are no more events left to occur, just before the simulation exits
- *
- * Note: Calling sched_cleanup() is guaranteed if the simulation has a normal exit
- *       but is not guaranteed in the case of fatal errors, crashes, or other
- *       abnormal exits.
- */
-void sched_cleanup();
+  /* new_process
+   *   will be called when a new process arrives (i.e., fork())
+   *
+   * proc - the new process that just arrived
+   */
+  void (*new_process)(void* state, int cpu, const struct process* proc);
 
+  /* finished_time_slice
+   *   will be called when the running process finished a time slice
+   *   (This is only called when the time slice ends with time remaining in the
+   *   current CPU burst.  If finishing the time slice happens at the same time
+   *   that the process blocks / terminates,
+   *   then blocked() / terminated() will be called instead).
+   *
+   * proc - the process whose time slice just ended
+   *
+   * Note: Time slice end events only occur if use_time_slice() is set to TRUE
+   */
+  void (*finished_time_slice)(void* state, int cpu, const struct process* proc);
 
-/* since C doesn't have a native boolean type, we made one */
-typedef enum {FALSE=0, TRUE=1} bool_t;
+  /* blocked
+   *   will be called when the running process blocks
+   *   (e.g., if it starts an I/O operation that it needs to wait to finish
+   *
+   * proc - the process that just blocked
+   */
+  void (*blocked)(void* state, int cpu, const struct process* proc);
+
+  /* unblocked
+   *   will be called when a blocked process unblocks
+   *   (e.g., if its I/O operation finished)
+   *
+   * proc - the process that just unblocked
+   */
+  void (*unblocked)(void* state, int cpu, const struct process* proc);
+
+  /* terminated
+   *   will be called when the running process terminates
+   *   (i.e., it finished it's last CPU burst)
+   *
+   * proc - the process that just terminated
+   *
+   * Note: "kill" commands and other ways to terminate a process that is not
+   *       currently running are not being simulated, so only the currently running
+   *       process can actually terminate.
+   */
+  void (*terminated)(void* state, int cpu, const struct process* proc);
+
+  /* cleanup
+   *   will be called exactly once after all processes have terminated and there
+   *   are no more events left to occur; releases state
+   *
+   * Note: Calling cleanup() is guaranteed if the simulation has a normal exit
+   *       but is not guaranteed in the case of fatal errors, crashes, or other
+   *       abnormal exits.
+   */
+  void (*cleanup)(void* state);
+
+  /* save (optional)
+   *   writes the policy's state to file (within a checkpoint)
+   */
+  void (*save)(void* state, FILE* file);
+
+  /* restore (optional)
+   *   called instead of init() when a simulation resumes from a checkpoint;
+   *   reads back what save() wrote and returns the state, or NULL if file is
+   *   truncated or inconsistent
+   *
+   * params - the policy's parameters, or NULL; these may override what was
+   *          saved
+   *
+   * Note: the simulator restores the time slice itself; the processes are
+   *       available through get_process()
+   */
+  void* (*restore)(const char* params, FILE* file);
+
+  /* events_batch (optional)
+   *   called instead of the event callbacks with every event at the current
+   *   time, in order, when the simulation batches events; should leave the
+   *   simulation as the callbacks, called one at a time, would have
+   *
+   * events - what each callback would have been called with; setting each
+   *          event's switched to the CPU its callback would have switched
+   *          (last) lets the simulator queue what follows from the switches
+   *          in the same order, so later ties come out the same
+   *
+   * Note: the simulator marks the CPUs of processes that blocked or
+   *       terminated idle after this returns; one at a time, it would have
+   *       done so after each event with idles_stopped set.  A switch one
+   *       event would have made does not drop the later events: a process
+   *       preempted in the batch can still have its time slice end in it.
+   */
+  void (*events_batch)(void* state, struct sched_event* events, unsigned int num_events);
+};
 
 
 /************************************
@@ -92,6 +178,20 @@ typedef enum {FALSE=0, TRUE=1} bool_t;
  */
 int context_switch(pid_t pid);
 
+/* context_switch_on
+ *   like context_switch, but changes the process running on the given CPU
+ *   (context_switch(pid) is context_switch_on(0, pid)); fails with a warning if
+ *   pid is already running on another CPU
+ */
+int context_switch_on(int cpu, pid_t pid);
+
+/* context_switch_idle
+ *   stops the process running on cpu (which stays ready), leaving cpu idle
+ *   until the next context switch on it; returns 0, or -1 on failure (an
+ *   invalid cpu)
+ */
+int context_switch_idle(int cpu);
+
 /* get_current_proc
  *   gets the pid of the current process
  *
@@ -100,6 +200,17 @@ int context_switch(pid_t pid);
  */
 pid_t get_current_proc();
 
+/* get_current_proc_on
+ *   gets the pid of the process running on the given CPU, or -1 if that CPU
+ *   is idle (get_current_proc() is get_current_proc_on(0))
+ */
+pid_t get_current_proc_on(int cpu);
+
+/* get_num_cpus
+ *   returns the number of simulated CPUs (numbered 0 .. get_num_cpus()-1)
+ */
+unsigned int get_num_cpus();
+
 /* get_time_slice
  *   gets the time slice parameter value
  *
@@ -116,6 +227,30 @@ time_ticks_t get_time_slice();
  */
 void use_time_slice(bool_t use);
 
+/* set_time_slice
+ *   sets the time slice for the next process dispatched (by context_switch()
+ *   or by continuing the running process after finished_time_slice())
+ *
+ * time_slice - ticks, or 0 for no time slice events
+ */
+void set_time_slice(time_ticks_t time_slice);
+
+/* get_current_time
+ *   returns the current simulated time
+ */
+time_ticks_t get_current_time();
+
+/* get_policy_param
+ *   returns the value of key in the parameters init() was given, or
+ *   default_value if it is not there
+ */
+unsigned long get_policy_param(const char* params, const char* key, unsigned long default_value);
+
+/* get_process
+ *   returns the process with this pid, or NULL if there is none
+ */
+const struct process* get_process(pid_t pid);
+
 /* print_process_list
  *   prints every process in the simulation to stderr
  *   This reflects all process' current state at the time this function is called.
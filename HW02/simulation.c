@@ -1,413 +1,1229 @@
-#include "scheduler.h"
+#include "schedsim.h"
 #include "event_queue.h"
+#include "alloc_stats.h"
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stddef.h>
-
-// whitespace characters to use as a delimiter
-#define WHITESPACE_DELIM " \t\r\n"
-
-static time_ticks_t INITIAL_TIME_SLICE = 0;
-static time_ticks_t TIME_SLICE = 0;
-
-static struct process** process_list = NULL; // array of pointers to processes; array index = pid
-static unsigned int num_procs = 0; // number of processes NOT in the TERMINATED state
-
-time_ticks_t current_time = 0;
-time_ticks_t time_started = 0;
-static const struct process* currently_running = NULL;
-
-
-pid_t get_current_proc() {
-  if (NULL == currently_running)
+#include <time.h>
+
+struct cpu {
+  const struct process* running; // NULL when the CPU is idle
+  time_ticks_t time_started;     // when running's remaining time was last updated,
+                                 // or when it starts to run if still being switched to
+  unsigned long num_dispatches;
+  // a switch undone at the time it was made never happened: what it changed
+  bool_t undoable;               // running was switched to at dispatched_at
+  time_ticks_t dispatched_at;
+  unsigned long undo_last_dispatch; // running's last_dispatch and cpu before that
+  int undo_cpu;
+  bool_t switched;         // switched during flush_batch(), which queues its next event
+  unsigned int switched_by; // the event of the batch that switched it, or UINT_MAX
+};
+
+/* Everything one simulation owns.  Nothing in this file is global except the
+ * pointer to the simulation whose sim_run() is active on this thread, which
+ * is what the scheduler API in scheduler.h acts on. */
+struct sim_ctx {
+  time_ticks_t initial_time_slice;
+  time_ticks_t time_slice;
+
+  struct workload workload; // owns every process and burst, unless streamed
+  struct process** process_list; // array of pointers to processes; array index = pid
+  unsigned int num_procs; // number of processes NOT in the TERMINATED state
+  unsigned long num_events; // events handled by the event loop
+  struct sim_counters counters; // (see counters.h)
+  unsigned int num_ready; // processes in the READY state, for counters.ready_length
+
+  time_ticks_t current_time;
+  struct cpu* cpus; // array index = cpu
+  unsigned int num_cpus;
+
+  const struct sched_policy* policy;
+  const char* policy_params;
+  void* policy_state; // what policy->init() returned
+
+  struct event_queue* events;
+  struct sched_event* batch; // the events at current_time handled so far, if batching (NULL if not)
+  unsigned int batch_length;
+  unsigned int batch_capacity;
+  bool_t batch_events; // whether to batch events (the policy has events_batch())
+  bool_t flushing; // in the policy's events_batch()
+  struct trace* trace;
+  time_ticks_t time_slice_override;
+  time_ticks_t switch_cost; // the cost model, see struct sim_options
+  time_ticks_t cache_penalty;
+  unsigned int cache_window;
+  unsigned long long switch_overhead; // CPU ticks spent switching so far
+  bool_t track_metrics;
+  struct metrics* metrics; // NULL unless track_metrics and a workload is loaded
+
+  struct workload_stream* stream; // NULL unless the workload is streamed
+  unsigned int slot_capacity; // slots process_list has room for (workload.num_procs are in use)
+  pid_t* free_pids; // stack of the slots of terminated processes, reused first
+  unsigned int num_free_pids;
+  unsigned int num_streamed; // processes read from the stream so far
+  unsigned int stream_num_procs; // processes in the stream
+  time_ticks_t last_arrival; // of the last process read from the stream
+
+  time_ticks_t checkpoint_every; // 0 for no checkpoints
+  time_ticks_t next_checkpoint;
+  const char* checkpoint_prefix;
+  char* restored_params; // the checkpoint's policy parameters, if policy_params points here
+};
+
+static _Thread_local struct sim_ctx* active = NULL;
+
+
+/*****************
+ * Scheduler API *
+ *****************/
+
+pid_t get_current_proc_on(int cpu) {
+  if (cpu < 0 || (unsigned int)cpu >= active->num_cpus || NULL == active->cpus[cpu].running)
     return -1;
   else
-    return currently_running->pid;
+    return active->cpus[cpu].running->pid;
+}
+
+pid_t get_current_proc() {
+  return get_current_proc_on(0);
+}
+
+unsigned int get_num_cpus() {
+  return active->num_cpus;
 }
 
 
 time_ticks_t get_time_slice() {
-  return TIME_SLICE;
+  return active->time_slice;
 }
 
 void use_time_slice(bool_t use) {
   if (use)
-    TIME_SLICE = INITIAL_TIME_SLICE;
+    active->time_slice = active->initial_time_slice;
   else
-    TIME_SLICE = 0;
+    active->time_slice = 0;
+}
+
+void set_time_slice(time_ticks_t time_slice) {
+  active->time_slice = time_slice;
+}
+
+time_ticks_t get_current_time() {
+  return active->current_time;
+}
+
+const struct process* get_process(pid_t pid) {
+  if (pid < 0 || (unsigned int)pid >= active->workload.num_procs)
+    return NULL;
+  return active->process_list[pid];
 }
 
 
 void print_process_list() {
   fprintf(stderr, "\nPROCESS LIST\n");
   unsigned int pid = 0;
-  for (const struct process* next_proc = process_list[pid];
+  for (const struct process* next_proc = active->process_list[pid];
        NULL != next_proc;
-       next_proc = process_list[++pid]) {
+       next_proc = active->process_list[++pid]) {
     print_process(next_proc);
     fprintf(stderr, "\n");
   }
 }
 
 
-void terminate_process(struct process* proc) {
+/**************
+ * Simulation *
+ **************/
+
+static void terminate_process(struct sim_ctx* ctx, struct process* proc) {
+  COUNT(ctx->num_ready -= (READY == proc->state));
   proc->state = TERMINATED;
-  --num_procs;
+  --ctx->num_procs;
+  metrics_terminated(ctx->metrics, proc, ctx->current_time);
 }
 
 
-void finish_burst(struct process* proc) {
-  struct burst* old_burst = proc->current_burst;
-  if (NULL != old_burst) {
-    proc->current_burst = old_burst->next_burst;
-    free(old_burst);
-  }
+static void finish_burst(struct sim_ctx* ctx, struct process* proc) {
+  // bursts stay in the workload's arena, which is freed all at once
+  if (BURSTS_LEFT(proc) > 0)
+    ++proc->current_burst;
 
-  if (NULL == proc->current_burst) {
-    terminate_process(proc);
-  } else if (CPU_BURST == proc->current_burst->type)
+  if (0 == BURSTS_LEFT(proc)) {
+    terminate_process(ctx, proc);
+  } else if (CPU_BURST == BURST_TYPE(proc)) {
+    COUNT(ctx->num_ready += (READY != proc->state));
     proc->state = READY;
-  else if (IO_BURST == proc->current_burst->type)
+  } else if (IO_BURST == BURST_TYPE(proc)) {
+    COUNT(ctx->num_ready -= (READY == proc->state));
     proc->state = BLOCKED;
+  }
 }
 
 
-time_ticks_t deduct_burst(struct process* proc, time_ticks_t amount) {
-  if (NULL == proc->current_burst) {
+static time_ticks_t deduct_burst(struct sim_ctx* ctx, struct process* proc, time_ticks_t amount) {
+  if (0 == BURSTS_LEFT(proc)) {
     if (TERMINATED != proc->state) {
       fprintf(stderr,
               "WARNING: Process %d is in state %d, despite having no remaining bursts! Changing state to TERMINATED.\n",
               proc->pid, proc->state);
-      terminate_process(proc);
+      terminate_process(ctx, proc);
     }
     return 0;
   }
-  // INVARIANT: proc->current_burst is valid
+  // INVARIANT: proc has a current burst
 
-  if (amount >= proc->current_burst->remaining_time) {
-    finish_burst(proc);
+  if (amount >= BURST_TIME(proc)) {
+    finish_burst(ctx, proc);
     return 0;
   } else {
-    proc->current_burst->remaining_time -= amount;
-    assert(proc->current_burst->remaining_time > 0);
-    return proc->current_burst->remaining_time;
+    BURST_TIME(proc) -= amount;
+    assert(BURST_TIME(proc) > 0);
+    return BURST_TIME(proc);
   }
 }
 
 
-void end_cpu_event() {
-  // set up next event on this proc (FINISH_CPU or FINISH_TIME_SLICE)
-  assert(CPU_BURST == currently_running->current_burst->type);
-  time_ticks_t run_for_time = currently_running->current_burst->remaining_time;
+/* marks cpu idle: its process blocked or terminated and nothing replaced it */
+static void idle_cpu(struct sim_ctx* ctx, unsigned int cpu) {
+  if (1 == ctx->num_cpus)
+    trace_event(ctx->trace, TRACE_IDLE, ctx->current_time, -1, 0);
+  else
+    trace_event(ctx->trace, TRACE_IDLE_ON, ctx->current_time, -1, cpu);
+  metrics_switch(ctx->metrics, ctx->cpus[cpu].running, NULL, ctx->current_time, ctx->current_time);
+  ctx->cpus[cpu].running = NULL;
+}
+
+
+/* idles every CPU whose process blocked or terminated (done after each event) */
+static void idle_stopped_cpus(struct sim_ctx* ctx) {
+#ifdef SIM_STATS
+  unsigned int busy = 0;
+#endif // SIM_STATS
+  for (unsigned int cpu = 0; cpu < ctx->num_cpus; ++cpu) {
+    if (NULL != ctx->cpus[cpu].running && READY != ctx->cpus[cpu].running->state)
+      idle_cpu(ctx, cpu);
+    COUNT(busy += (NULL != ctx->cpus[cpu].running));
+  }
+#ifdef SIM_STATS
+  // every process left running is READY
+  assert(busy <= ctx->num_ready);
+  sample_count_add(&ctx->counters.ready_length, ctx->num_ready - busy);
+#endif // SIM_STATS
+}
+
+
+static void end_cpu_event(struct sim_ctx* ctx, int cpu) {
+  // set up next event on the proc running on cpu (FINISH_CPU or FINISH_TIME_SLICE)
+  const struct process* running = ctx->cpus[cpu].running;
+  assert(CPU_BURST == BURST_TYPE(running));
+  time_ticks_t run_for_time = BURST_TIME(running);
   event_type_t event_type = FINISH_CPU;
 
-  if (get_time_slice() > 0 && get_time_slice() < run_for_time) {
-    run_for_time = get_time_slice();
+  if (ctx->time_slice > 0 && ctx->time_slice < run_for_time) {
+    run_for_time = ctx->time_slice;
     event_type = FINISH_TIME_SLICE;
   }
 
-  new_event(current_time + run_for_time, event_type, process_list[currently_running->pid]);
+  // (the burst starts once the switch to it is done)
+  new_event(ctx->events, ctx->cpus[cpu].time_started + run_for_time, event_type, ctx->process_list[running->pid]);
 }
 
 
-int context_switch(pid_t pid) {
+/* takes cpu from the process running on it (if any), before it is switched
+ * to another or idled */
+static void stop_running(struct sim_ctx* ctx, struct cpu* target) {
+  if (NULL == target->running)
+    return;
+  if (READY == target->running->state) {
+    remove_events(ctx->events, target->running->pid); // remove the FINISH_CPU or FINISH_TIME_SLICE event
+  }
+  if (target->time_started > ctx->current_time)
+    ctx->switch_overhead -= target->time_started - ctx->current_time; // the switch to it is cut short
+  if (target->undoable && target->dispatched_at == ctx->current_time) {
+    // ... before it began: the process never ran here, so neither its cache
+    // nor the other processes' cache_window distances change
+    struct process* undone = ctx->process_list[target->running->pid];
+    undone->last_dispatch = target->undo_last_dispatch;
+    undone->cpu = target->undo_cpu;
+    --target->num_dispatches;
+  }
+}
+
+
+int context_switch_on(int cpu, pid_t pid) {
+  struct sim_ctx* ctx = active;
+  COUNT(++ctx->counters.switches_requested);
+  if (cpu < 0 || (unsigned int)cpu >= ctx->num_cpus) {
+    trace_event(ctx->trace, TRACE_INVALID_CPU, ctx->current_time, cpu, 0);
+    COUNT(++ctx->counters.switches_rejected);
+    return -1;
+  }
   if(pid < 0) {
-    printf("WARNING: invalid pid value %d\n", pid);
+    trace_event(ctx->trace, TRACE_INVALID_PID, ctx->current_time, pid, 0);
+    COUNT(++ctx->counters.switches_rejected);
     return -1;
   }
-  if (READY != process_list[pid]->state) {
-    printf("WARNING: process %d is not in the READY state\n", pid);
+  if (READY != ctx->process_list[pid]->state) {
+    trace_event(ctx->trace, TRACE_NOT_READY, ctx->current_time, pid, 0);
+    COUNT(++ctx->counters.switches_rejected);
     return -1;
   }
-  if (NULL != currently_running && currently_running->pid == pid) {
-    printf("WARNING: attempt to context switch to currently running process (pid=%d)\n", pid);
+  struct cpu* target = &ctx->cpus[cpu];
+  struct process* proc = ctx->process_list[pid];
+  if (NULL != target->running && target->running->pid == pid) {
+    trace_event(ctx->trace, TRACE_ALREADY_RUNNING, ctx->current_time, pid, 0);
+    COUNT(++ctx->counters.switches_rejected);
     return -1;
   }
-  // INVARIANTS: pid is valid, not the currently_running process, and the process is able to run
-
-  if (NULL != currently_running && READY == currently_running->state) {
-    remove_events(currently_running->pid); // remove the FINISH_CPU or FINISH_TIME_SLICE event
+  if (-1 != proc->cpu && proc == ctx->cpus[proc->cpu].running) {
+    trace_event(ctx->trace, TRACE_RUNNING_ELSEWHERE, ctx->current_time, pid, proc->cpu);
+    COUNT(++ctx->counters.switches_rejected);
+    return -1;
   }
+  // INVARIANTS: pid is valid, not running on any CPU, and the process is able to run
+
+  stop_running(ctx, target);
+
+  // the CPU spends the switch's cost before proc starts its burst
+  time_ticks_t cost = ctx->switch_cost;
+  if (0 != ctx->cache_penalty && -1 != proc->cpu &&
+      (proc->cpu != cpu || target->num_dispatches - proc->last_dispatch >= ctx->cache_window))
+    cost += ctx->cache_penalty; // resuming with a cold cache
+  ctx->switch_overhead += cost;
+  target->undoable = TRUE;
+  target->dispatched_at = ctx->current_time;
+  target->undo_last_dispatch = proc->last_dispatch;
+  target->undo_cpu = proc->cpu;
+  proc->last_dispatch = ++target->num_dispatches;
+
+  metrics_switch(ctx->metrics, target->running, proc, ctx->current_time, ctx->current_time + cost);
+  target->running = proc;
+  target->time_started = ctx->current_time + cost;
+  proc->cpu = cpu;
+  if (1 == ctx->num_cpus)
+    trace_event(ctx->trace, TRACE_RUNNING, ctx->current_time, pid, 0);
+  else
+    trace_event(ctx->trace, TRACE_RUNNING_ON, ctx->current_time, pid, cpu);
+  if (ctx->flushing)
+    target->switched = TRUE;
+  else
+    end_cpu_event(ctx, cpu);
+  return 0;
+}
+
+int context_switch(pid_t pid) {
+  return context_switch_on(0, pid);
+}
 
-  currently_running = process_list[pid];
-  time_started = current_time;
-  printf("(t=%d) running proc %d\n", current_time, currently_running->pid);
-  end_cpu_event();
+int context_switch_idle(int cpu) {
+  struct sim_ctx* ctx = active;
+  COUNT(++ctx->counters.switches_requested);
+  if (cpu < 0 || (unsigned int)cpu >= ctx->num_cpus) {
+    trace_event(ctx->trace, TRACE_INVALID_CPU, ctx->current_time, cpu, 0);
+    COUNT(++ctx->counters.switches_rejected);
+    return -1;
+  }
+  struct cpu* target = &ctx->cpus[cpu];
+  if (NULL == target->running)
+    return 0;
+  stop_running(ctx, target);
+  idle_cpu(ctx, cpu);
+  target->switched = FALSE; // (nothing to queue for it now)
   return 0;
 }
 
-time_ticks_t event_loop() {
-  for (const struct evt* event = pop_next_event();
-       NULL != event && num_procs > 0;
-       event = pop_next_event()) {
+
+/***************
+ * Checkpoints *
+ ***************/
+
+/* A checkpoint holds a simulation between two events, in native byte order
+ * and layout (like a .procb file):
+ *   struct checkpoint_header
+ *   char params[params_length]              (the policy's parameters)
+ *   struct checkpoint_cpu[num_cpus]
+ *   struct checkpoint_process[num_procs]    (index = pid)
+ *   uint32_t bursts[num_bursts]             (the bursts each process still has
+ *                                            ahead, consecutive, alternating
+ *                                            from its first_burst_type)
+ *   struct checkpoint_event[num_queued_events] (in the order they pop)
+ *   uint64_t policy_length, then what the policy's save() wrote
+ *   the metrics (see metrics_save()), if has_metrics
+ */
+#define CHECKPOINT_MAGIC "SCHEDCKP"
+#define CHECKPOINT_VERSION 3
+
+struct checkpoint_header {
+  char magic[8]; // CHECKPOINT_MAGIC, not NUL-terminated
+  uint32_t version;
+  char policy[32];
+  uint32_t params_length;
+  uint32_t num_cpus;
+  uint32_t workload_time_slice;
+  uint32_t initial_time_slice;
+  uint32_t time_slice;
+  uint32_t checkpoint_time; // the multiple of checkpoint_every it was taken at
+  uint32_t current_time;
+  uint32_t num_procs;
+  uint32_t num_live_procs;
+  uint32_t num_queued_events;
+  uint32_t has_metrics;
+  uint64_t num_bursts;
+  uint64_t num_events;
+  uint32_t switch_cost;
+  uint32_t cache_penalty;
+  uint32_t cache_window;
+  uint32_t reserved;
+  uint64_t switch_overhead;
+};
+
+struct checkpoint_cpu {
+  int32_t running; // pid, or -1 if idle
+  uint32_t time_started;
+  uint64_t num_dispatches;
+};
+
+struct checkpoint_process {
+  uint32_t tickets;
+  uint32_t arrival_time;
+  int32_t cpu;
+  uint16_t state;
+  uint16_t first_burst_type;
+  uint32_t num_bursts;
+  uint32_t reserved;
+  uint64_t last_dispatch;
+};
+
+struct checkpoint_event {
+  uint32_t pid;
+  uint32_t time;
+  uint32_t type;
+};
+
+
+/* writes the simulation, about to handle popped, to filename; returns 0 on
+ * success or -1 on failure (with errno set) */
+static int write_checkpoint(struct sim_ctx* ctx, const struct evt* popped, time_ticks_t checkpoint_time,
+                            const char* filename) {
+  FILE* file = fopen(filename, "wb");
+  if (NULL == file)
+    return -1;
+  setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+  struct checkpoint_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+  header.version = CHECKPOINT_VERSION;
+  assert(strlen(ctx->policy->name) < sizeof(header.policy));
+  strcpy(header.policy, ctx->policy->name);
+  header.params_length = (NULL != ctx->policy_params) ? strlen(ctx->policy_params) : 0;
+  header.num_cpus = ctx->num_cpus;
+  header.workload_time_slice = ctx->workload.time_slice;
+  header.initial_time_slice = ctx->initial_time_slice;
+  header.time_slice = ctx->time_slice;
+  header.checkpoint_time = checkpoint_time;
+  header.current_time = ctx->current_time;
+  header.num_procs = ctx->workload.num_procs;
+  header.num_live_procs = ctx->num_procs;
+  header.has_metrics = (NULL != ctx->metrics);
+  header.num_events = ctx->num_events;
+  header.switch_cost = ctx->switch_cost;
+  header.cache_penalty = ctx->cache_penalty;
+  header.cache_window = ctx->cache_window;
+  header.switch_overhead = ctx->switch_overhead;
+  for (unsigned int pid = 0; pid < ctx->workload.num_procs; ++pid)
+    header.num_bursts += BURSTS_LEFT(ctx->process_list[pid]);
+
+  // a process has at most one event, and popped is the one it no longer has queued
+  const struct evt** events = malloc((ctx->workload.num_procs + 1) * sizeof(const struct evt*));
+  assert(NULL != events);
+  events[0] = popped;
+  header.num_queued_events = 1 + event_queue_snapshot(ctx->events, &events[1]);
+
+  fwrite(&header, sizeof(header), 1, file);
+  if (0 != header.params_length)
+    fwrite(ctx->policy_params, 1, header.params_length, file);
+  for (unsigned int cpu = 0; cpu < ctx->num_cpus; ++cpu) {
+    struct checkpoint_cpu entry;
+    entry.running = (NULL != ctx->cpus[cpu].running) ? ctx->cpus[cpu].running->pid : -1;
+    entry.time_started = ctx->cpus[cpu].time_started;
+    entry.num_dispatches = ctx->cpus[cpu].num_dispatches;
+    fwrite(&entry, sizeof(entry), 1, file);
+  }
+  for (unsigned int pid = 0; pid < ctx->workload.num_procs; ++pid) {
+    const struct process* proc = ctx->process_list[pid];
+    struct checkpoint_process entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.tickets = proc->tickets;
+    entry.arrival_time = proc->arrival_time;
+    entry.cpu = proc->cpu;
+    entry.state = proc->state;
+    entry.first_burst_type = (BURSTS_LEFT(proc) > 0) ? BURST_TYPE(proc) : CPU_BURST;
+    entry.num_bursts = BURSTS_LEFT(proc);
+    entry.last_dispatch = proc->last_dispatch;
+    fwrite(&entry, sizeof(entry), 1, file);
+  }
+  for (unsigned int pid = 0; pid < ctx->workload.num_procs; ++pid) {
+    const struct process* proc = ctx->process_list[pid];
+    fwrite(&proc->bursts[proc->current_burst], sizeof(time_ticks_t), BURSTS_LEFT(proc), file);
+  }
+  for (unsigned int i = 0; i < header.num_queued_events; ++i) {
+    struct checkpoint_event entry = {events[i]->proc->pid, events[i]->time, events[i]->type};
+    fwrite(&entry, sizeof(entry), 1, file);
+  }
+  free(events);
+
+  // the policy writes to memory first, so its part can be length-prefixed
+  char* policy_data = NULL;
+  size_t policy_length = 0;
+  FILE* policy_file = open_memstream(&policy_data, &policy_length);
+  assert(NULL != policy_file);
+  ctx->policy->save(ctx->policy_state, policy_file);
+  fclose(policy_file);
+  uint64_t length = policy_length;
+  fwrite(&length, sizeof(length), 1, file);
+  fwrite(policy_data, 1, policy_length, file);
+  free(policy_data);
+
+  if (NULL != ctx->metrics)
+    metrics_save(ctx->metrics, file);
+
+  int ok = !ferror(file);
+  if (0 != fclose(file))
+    ok = 0;
+  return ok ? 0 : -1;
+}
+
+
+/* checkpoints the simulation before it handles popped, the first event at or
+ * past next_checkpoint, under the last multiple of checkpoint_every before it */
+static void checkpoint(struct sim_ctx* ctx, const struct evt* popped) {
+  time_ticks_t checkpoint_time = popped->time - popped->time % ctx->checkpoint_every;
+  ctx->next_checkpoint = checkpoint_time + ctx->checkpoint_every;
+
+  char* filename = malloc(strlen(ctx->checkpoint_prefix) + 32);
+  char* tmp_filename = malloc(strlen(ctx->checkpoint_prefix) + 36);
+  assert(NULL != filename && NULL != tmp_filename);
+  sprintf(filename, "%s.%u.ckpt", ctx->checkpoint_prefix, checkpoint_time);
+  // written under another name first, so a crash never leaves half a checkpoint
+  sprintf(tmp_filename, "%s.tmp", filename);
+  if (0 != write_checkpoint(ctx, popped, checkpoint_time, tmp_filename) || 0 != rename(tmp_filename, filename)) {
+    fprintf(stderr, "WARNING: could not write checkpoint %s: %s\n", filename, strerror(errno));
+    remove(tmp_filename);
+  }
+  free(filename);
+  free(tmp_filename);
+}
+
+
+/*************
+ * Streaming *
+ *************/
+
+/* A process slot of a streamed workload: a process and the array its bursts
+ * are read into, both reused with the slot's pid once the process terminates */
+struct stream_slot {
+  struct process proc; // first, so process_list[pid] points at the slot
+  time_ticks_t* bursts;
+  unsigned long burst_capacity;
+};
+
+
+/* adds a slot to a streamed workload and returns its pid */
+static pid_t add_stream_slot(struct sim_ctx* ctx) {
+  pid_t pid = ctx->workload.num_procs;
+  if ((unsigned int)pid == ctx->slot_capacity) {
+    ctx->slot_capacity = (0 == ctx->slot_capacity) ? 64 : 2 * ctx->slot_capacity;
+    ctx->process_list = realloc(ctx->process_list, (ctx->slot_capacity + 1) * sizeof(struct process*));
+    ctx->free_pids = realloc(ctx->free_pids, ctx->slot_capacity * sizeof(pid_t));
+    assert(NULL != ctx->process_list && NULL != ctx->free_pids);
+  }
+  struct stream_slot* slot = calloc(1, sizeof(struct stream_slot));
+  assert(NULL != slot);
+  ctx->process_list[pid] = &slot->proc;
+  ctx->process_list[pid + 1] = NULL;
+  ++ctx->workload.num_procs;
+  return pid;
+}
+
+
+/* reads the next process of a streamed workload, if there is one, into a free
+ * slot and queues its arrival */
+static void stream_next_process(struct sim_ctx* ctx) {
+  if (ctx->num_streamed == ctx->stream_num_procs)
+    return;
+  pid_t pid = (ctx->num_free_pids > 0) ? ctx->free_pids[--ctx->num_free_pids] : add_stream_slot(ctx);
+  struct stream_slot* slot = (struct stream_slot*)ctx->process_list[pid];
+  struct process* proc = &slot->proc;
+  read_workload_process(ctx->stream, proc, &slot->bursts, &slot->burst_capacity);
+  proc->pid = pid;
+  proc->cpu = -1;
+  if (proc->arrival_time < ctx->last_arrival) {
+    fprintf(stderr, "ERROR in file contents\nProcess %u arrives at %u, before the one ahead of it at %u "
+            "(a streamed workload has to be in order of arrival)\n",
+            ctx->num_streamed, proc->arrival_time, ctx->last_arrival);
+    exit(EXIT_FAILURE);
+  }
+  ctx->last_arrival = proc->arrival_time;
+  ++ctx->num_streamed;
+  ++ctx->num_procs;
+  metrics_new_process(ctx->metrics, pid);
+  new_event(ctx->events, proc->arrival_time, ARRIVAL, proc);
+}
+
+
+/***********
+ * Batches *
+ ***********/
+
+/* With sim_options.batch_events (for a policy with events_batch()), the event
+ * loop handles every event at one time before the policy hears of any, then
+ * hands it them all at once: the switches a policy makes and undoes when
+ * events arrive one at a time, and their events, never happen.  The events
+ * the batch does lead to are queued afterwards, in the order of the events
+ * that led to them, as they would have been one at a time (so later ties
+ * between them pop in the same order).
+ *
+ * So a batched run has the same schedule, end time and switch overhead (a
+ * switch undone at once costs nothing, see stop_running()) as one without.
+ * What differs is only what those in-between switches leave behind: the
+ * trace lines of the switches and of CPUs idle in between, the dispatch
+ * counts of the metrics, and a response time taken at a dispatch undone at
+ * once (the metrics count it as the process's first). */
+
+/* adds an event for the policy to the batch at current_time */
+static void batch_event(struct sim_ctx* ctx, sched_event_type_t type, int cpu, const struct process* proc) {
+  if (ctx->batch_length == ctx->batch_capacity) {
+    // (a streamed workload adds processes as it goes)
+    ctx->batch_capacity *= 2;
+    ctx->batch = realloc(ctx->batch, ctx->batch_capacity * sizeof(struct sched_event));
+    assert(NULL != ctx->batch);
+  }
+  struct sched_event* event = &ctx->batch[ctx->batch_length++];
+  event->type = type;
+  event->cpu = cpu;
+  event->proc = proc;
+  event->switched = -1;
+  // the bursts that end at this time all end before its first event, so the
+  // CPUs of the processes they stop are idled after that event alone
+  event->idles_stopped = (1 == ctx->batch_length);
+}
+
+
+/* hands the policy the batch, then queues what each of its events led to, in
+ * their order: a blocked process's FINISH_IO, and the next event on the CPU
+ * it switched (as the policy says) or that continues after a time slice */
+static void flush_batch(struct sim_ctx* ctx) {
+  ctx->flushing = TRUE;
+  ctx->policy->events_batch(ctx->policy_state, ctx->batch, ctx->batch_length);
+  ctx->flushing = FALSE;
+
+  for (unsigned int i = 0; i < ctx->batch_length; ++i) {
+    int cpu = ctx->batch[i].switched;
+    if (cpu >= 0 && (unsigned int)cpu < ctx->num_cpus)
+      ctx->cpus[cpu].switched_by = i;
+  }
+  for (unsigned int i = 0; i < ctx->batch_length; ++i) {
+    const struct sched_event* event = &ctx->batch[i];
+    struct process* proc = ctx->process_list[event->proc->pid];
+    if (SCHED_BLOCKED == event->type)
+      new_event(ctx->events, ctx->current_time + BURST_TIME(proc), FINISH_IO, proc);
+    else if (SCHED_TERMINATED == event->type && NULL != ctx->stream)
+      ctx->free_pids[ctx->num_free_pids++] = proc->pid; // (the sweep after this is done with it)
+
+    struct cpu* target = (event->switched >= 0) ? &ctx->cpus[event->switched] : NULL;
+    if (NULL != target && target->switched && i == target->switched_by) {
+      target->switched = FALSE;
+      end_cpu_event(ctx, event->switched);
+    } else if (SCHED_FINISHED_TIME_SLICE == event->type && !ctx->cpus[event->cpu].switched &&
+               proc == ctx->cpus[event->cpu].running) {
+      end_cpu_event(ctx, event->cpu); // continuing same proc after time slice requires new time slice event
+    }
+  }
+  // switched by no event's doing (or the policy did not say)
+  for (unsigned int cpu = 0; cpu < ctx->num_cpus; ++cpu) {
+    if (ctx->cpus[cpu].switched) {
+      ctx->cpus[cpu].switched = FALSE;
+      end_cpu_event(ctx, cpu);
+    }
+    ctx->cpus[cpu].switched_by = UINT_MAX;
+  }
+  ctx->batch_length = 0;
+}
+
+
+static time_ticks_t event_loop(struct sim_ctx* ctx) {
+  for (const struct evt* next_event = pop_next_event(ctx->events);
+       NULL != next_event && ctx->num_procs > 0;
+       next_event = pop_next_event(ctx->events)) {
+    if (0 != ctx->checkpoint_every && next_event->time >= ctx->next_checkpoint)
+      checkpoint(ctx, next_event);
+    // copy the event out of its process: handling it can queue that process's next event
+    const struct evt event = *next_event;
+    ++ctx->num_events;
+    COUNT(++ctx->counters.events[event.type]);
+    if (NULL != ctx->stream && ARRIVAL == event.type)
+      stream_next_process(ctx); // the next arrival goes ahead of anything else at its time
 
 #ifdef DEBUG
     fprintf(stderr, "Handling Event: ");
-    print_event(event);
+    print_event(&event);
 #endif // DEBUG
 
-    current_time = event->time;
-    // update remaining_time on the currently_running process (ending the current burst, if it has finished)
-    if (current_time > time_started && NULL != currently_running) {
-      deduct_burst(process_list[currently_running->pid], current_time - time_started);
-      time_started = current_time;
+    ctx->current_time = event.time;
+    // update remaining_time on every running process (ending its current burst, if it has finished)
+    for (unsigned int cpu = 0; cpu < ctx->num_cpus; ++cpu) {
+      struct cpu* this_cpu = &ctx->cpus[cpu];
+      if (ctx->current_time > this_cpu->time_started && NULL != this_cpu->running) {
+        deduct_burst(ctx, ctx->process_list[this_cpu->running->pid], ctx->current_time - this_cpu->time_started);
+        this_cpu->time_started = ctx->current_time;
+      }
     }
 
-    switch (event->type) {
+    switch (event.type) {
 
     case ARRIVAL:
-      assert(CPU_BURST == event->proc->current_burst->type);
-      event->proc->state = READY;
-      printf("(t=%d) proc %d arrived\n", current_time, event->proc->pid);
-      sched_new_process(event->proc);
+      assert(CPU_BURST == BURST_TYPE(event.proc));
+      event.proc->state = READY;
+      COUNT(++ctx->num_ready);
+      trace_event(ctx->trace, TRACE_ARRIVED, ctx->current_time, event.proc->pid, 0);
+      metrics_ready(ctx->metrics, event.proc, ctx->current_time);
+      if (NULL != ctx->batch)
+        batch_event(ctx, SCHED_NEW_PROCESS, -1, event.proc);
+      else
+        ctx->policy->new_process(ctx->policy_state, -1, event.proc);
       break;
 
     case FINISH_TIME_SLICE:
-      assert(CPU_BURST == event->proc->current_burst->type);
-      assert(READY == event->proc->state);
-      if (TERMINATED == event->proc->state) {
-        assert(NULL == event->proc->current_burst);
-        sched_terminated(event->proc);
+      assert(CPU_BURST == BURST_TYPE(event.proc));
+      assert(READY == event.proc->state);
+      if (TERMINATED == event.proc->state) {
+        assert(0 == BURSTS_LEFT(event.proc));
+        if (NULL != ctx->batch)
+          batch_event(ctx, SCHED_TERMINATED, event.proc->cpu, event.proc);
+        else
+          ctx->policy->terminated(ctx->policy_state, event.proc->cpu, event.proc);
       } else {
-        assert(CPU_BURST == event->proc->current_burst->type);
-        assert(READY == event->proc->state);
-        pid_t prev_proc = currently_running->pid;
-        sched_finished_time_slice(event->proc);
-        if (prev_proc == currently_running->pid)
-          end_cpu_event(); // continuing same proc after time slice requires new time slice event
+        assert(CPU_BURST == BURST_TYPE(event.proc));
+        assert(READY == event.proc->state);
+        int cpu = event.proc->cpu;
+        if (NULL != ctx->batch) {
+          batch_event(ctx, SCHED_FINISHED_TIME_SLICE, cpu, event.proc); // flush_batch() continues it
+          break;
+        }
+        ctx->policy->finished_time_slice(ctx->policy_state, cpu, event.proc);
+        if (event.proc == ctx->cpus[cpu].running)
+          end_cpu_event(ctx, cpu); // continuing same proc after time slice requires new time slice event
       }
       break;
 
     case FINISH_CPU:
-      if (TERMINATED == event->proc->state) {
-        assert(NULL == event->proc->current_burst);
-        sched_terminated(event->proc);
+      if (TERMINATED == event.proc->state) {
+        assert(0 == BURSTS_LEFT(event.proc));
+        if (NULL != ctx->batch)
+          batch_event(ctx, SCHED_TERMINATED, event.proc->cpu, event.proc);
+        else
+          ctx->policy->terminated(ctx->policy_state, event.proc->cpu, event.proc);
 
       } else {
-        assert(IO_BURST == event->proc->current_burst->type);
-        assert(BLOCKED == event->proc->state);
-        new_event(current_time + event->proc->current_burst->remaining_time,
+        assert(IO_BURST == BURST_TYPE(event.proc));
+        assert(BLOCKED == event.proc->state);
+        trace_event(ctx->trace, TRACE_BLOCKED, ctx->current_time, event.proc->pid, 0);
+        if (NULL != ctx->batch) {
+          batch_event(ctx, SCHED_BLOCKED, event.proc->cpu, event.proc); // flush_batch() queues its FINISH_IO
+          break;
+        }
+        new_event(ctx->events,
+                  ctx->current_time + BURST_TIME(event.proc),
                   FINISH_IO,
-                  event->proc);
-        printf("(t=%d) proc %d blocked for I/O\n", current_time, event->proc->pid);
-        sched_blocked(event->proc);
+                  event.proc);
+        ctx->policy->blocked(ctx->policy_state, event.proc->cpu, event.proc);
       }
       break;
 
     case FINISH_IO:
-      assert(IO_BURST == event->proc->current_burst->type);
-      assert(BLOCKED == event->proc->state);
-      finish_burst(event->proc);
+      assert(IO_BURST == BURST_TYPE(event.proc));
+      assert(BLOCKED == event.proc->state);
+      finish_burst(ctx, event.proc);
 
-      if (TERMINATED == event->proc->state) {
-        assert(NULL == event->proc->current_burst);
-        sched_terminated(event->proc);
+      if (TERMINATED == event.proc->state) {
+        assert(0 == BURSTS_LEFT(event.proc));
+        if (NULL != ctx->batch)
+          batch_event(ctx, SCHED_TERMINATED, event.proc->cpu, event.proc);
+        else
+          ctx->policy->terminated(ctx->policy_state, event.proc->cpu, event.proc);
 
       } else {
         // proc should not be TERMINATED immediately after
         // finishing an I/O burst (only after a CPU burst)
-        assert(CPU_BURST == event->proc->current_burst->type);
-        assert(READY == event->proc->state);
-        printf("(t=%d) proc %d finished I/O\n", current_time, event->proc->pid);
-        sched_unblocked(event->proc);
+        assert(CPU_BURST == BURST_TYPE(event.proc));
+        assert(READY == event.proc->state);
+        trace_event(ctx->trace, TRACE_FINISHED_IO, ctx->current_time, event.proc->pid, 0);
+        metrics_ready(ctx->metrics, event.proc, ctx->current_time);
+        if (NULL != ctx->batch)
+          batch_event(ctx, SCHED_UNBLOCKED, event.proc->cpu, event.proc);
+        else
+          ctx->policy->unblocked(ctx->policy_state, event.proc->cpu, event.proc);
       }
       break;
 
     default:
-      fprintf(stderr, "ERROR: Unrecognized event type %d at time %u; ignoring event...\n", event->type, event->time);
+      fprintf(stderr, "ERROR: Unrecognized event type %d at time %u; ignoring event...\n", event.type, event.time);
     }
-    free((void*)event);
-    event = NULL;
 
-    if (NULL != currently_running && READY != currently_running->state) {
-        printf("(t=%d) idle\n", current_time);
-        currently_running = NULL;
+    if (NULL != ctx->batch) {
+      if (has_event_at(ctx->events, ctx->current_time))
+        continue; // the rest of this time's events go in the same batch
+      flush_batch(ctx);
     }
+
+    idle_stopped_cpus(ctx);
+    // the policy and the CPUs are done with a process once terminated() is called
+    // (flush_batch() frees the slots of a batch)
+    if (NULL != ctx->stream && NULL == ctx->batch && ARRIVAL != event.type && TERMINATED == event.proc->state)
+      ctx->free_pids[ctx->num_free_pids++] = event.proc->pid;
+  }
+  if (NULL != ctx->batch && 0 != ctx->batch_length) {
+    // the last processes all finished at the start of the last time
+    flush_batch(ctx);
+    idle_stopped_cpus(ctx);
   }
   // INVARIANT: all processes are TERMINATED state AND event loop is empty
-  return current_time;
+  return ctx->current_time;
+}
+
+
+/***********
+ * Library *
+ ***********/
+
+void sim_default_options(struct sim_options* options) {
+  memset(options, 0, sizeof(struct sim_options));
+  options->policy = sched_policies[0];
+  options->policy_params = NULL;
+  options->num_cpus = 1;
+  options->trace_mode = TRACE_TEXT;
+  options->trace_file = NULL;
+  options->metrics = FALSE;
+  options->time_slice = 0;
+  options->checkpoint_every = 0;
+  options->checkpoint_prefix = NULL;
+  options->switch_cost = 0;
+  options->cache_penalty = 0;
+  options->cache_window = 1;
+  options->batch_events = FALSE;
+}
+
+
+struct sim_ctx* sim_create(const struct sim_options* options) {
+  assert(options->num_cpus >= 1 && options->num_cpus <= SIM_MAX_CPUS);
+  if (!options->policy->multi_cpu && options->num_cpus > 1) {
+    fprintf(stderr, "ERROR: the %s policy only runs on one CPU\n", options->policy->name);
+    return NULL;
+  }
+  if (options->batch_events && NULL == options->policy->events_batch) {
+    fprintf(stderr, "ERROR: the %s policy cannot batch events\n", options->policy->name);
+    return NULL;
+  }
+  if (0 != options->checkpoint_every && NULL == options->policy->save) {
+    fprintf(stderr, "ERROR: the %s policy cannot be checkpointed\n", options->policy->name);
+    return NULL;
+  }
+  struct sim_ctx* ctx = calloc(1, sizeof(struct sim_ctx));
+  assert(NULL != ctx);
+  ctx->num_cpus = options->num_cpus;
+  ctx->policy = options->policy;
+  ctx->policy_params = options->policy_params;
+
+  ctx->cpus = calloc(ctx->num_cpus, sizeof(struct cpu));
+  assert(NULL != ctx->cpus);
+  ctx->events = event_queue_create();
+  ctx->trace = trace_create(options->trace_mode, (NULL != options->trace_file) ? options->trace_file : stdout);
+  // metrics are sized by the workload, so sim_load_file() creates them
+  ctx->track_metrics = options->metrics;
+  ctx->time_slice_override = options->time_slice;
+  ctx->checkpoint_every = options->checkpoint_every;
+  ctx->checkpoint_prefix = (NULL != options->checkpoint_prefix) ? options->checkpoint_prefix : "checkpoint";
+  ctx->switch_cost = options->switch_cost;
+  ctx->cache_penalty = options->cache_penalty;
+  ctx->cache_window = options->cache_window;
+  ctx->batch_events = options->batch_events;
+  return ctx;
 }
 
-void load_file(const char* filename) {
-  char line[1024];
-  FILE* file = fopen(filename, "r");
+
+void sim_load_file(struct sim_ctx* ctx, const char* filename) {
+  struct workload workload;
+  load_workload(filename, &workload);
+  sim_use_workload(ctx, &workload);
+}
+
+
+void sim_use_workload(struct sim_ctx* ctx, struct workload* workload) {
+  assert(NULL == ctx->process_list); // one workload per simulation
+  ctx->workload = *workload;
+  ctx->time_slice = ctx->initial_time_slice =
+    (0 != ctx->time_slice_override) ? ctx->time_slice_override : ctx->workload.time_slice;
+  ctx->num_procs = ctx->workload.num_procs;
+
+  ctx->process_list = malloc((ctx->num_procs + 1) * sizeof(struct process*));
+  assert(NULL != ctx->process_list);
+  for (unsigned int pid = 0; pid < ctx->num_procs; ++pid) {
+    ctx->process_list[pid] = &ctx->workload.procs[pid];
+    ctx->process_list[pid]->cpu = -1;
+    new_event(ctx->events, ctx->process_list[pid]->arrival_time, ARRIVAL, ctx->process_list[pid]);
+  }
+  ctx->process_list[ctx->num_procs] = NULL;
+
+  if (ctx->track_metrics)
+    ctx->metrics = metrics_create(ctx->workload.num_procs, ctx->num_cpus);
+  ctx->next_checkpoint = ctx->checkpoint_every;
+}
+
+
+void sim_stream_file(struct sim_ctx* ctx, const char* filename) {
+  assert(NULL == ctx->process_list); // one workload per simulation
+  if (0 != ctx->checkpoint_every) {
+    fprintf(stderr, "ERROR: a streamed workload cannot be checkpointed\n");
+    exit(EXIT_FAILURE);
+  }
+  ctx->stream = open_workload_stream(filename, &ctx->workload.time_slice, &ctx->stream_num_procs);
+  ctx->time_slice = ctx->initial_time_slice =
+    (0 != ctx->time_slice_override) ? ctx->time_slice_override : ctx->workload.time_slice;
+
+  // slots are added as they are needed, each process is counted as it is read
+  ctx->process_list = calloc(1, sizeof(struct process*));
+  assert(NULL != ctx->process_list);
+  if (ctx->track_metrics)
+    ctx->metrics = metrics_create(0, ctx->num_cpus);
+  stream_next_process(ctx); // each arrival reads the next
+}
+
+
+/* reads count items from a checkpoint, or exits */
+static void read_checkpoint(FILE* file, const char* filename, void* data, size_t size, size_t count) {
+  if (count != fread(data, size, count, file)) {
+    fprintf(stderr, "ERROR reading file: checkpoint %s is truncated\n", filename);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* opens a checkpoint and reads its header, or exits */
+static FILE* open_checkpoint(const char* filename, struct checkpoint_header* header) {
+  FILE* file = fopen(filename, "rb");
   if (NULL == file) {
     perror("ERROR opening file");
     exit(EXIT_FAILURE);
   }
-  
-  // Get the TIME_SLICE value
-  if (NULL == fgets(line, 1024, file)) {
-    perror("ERROR reading file");
-    fclose(file);
+  read_checkpoint(file, filename, header, sizeof(struct checkpoint_header), 1);
+  if (0 != memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) ||
+      CHECKPOINT_VERSION != header->version || '\0' != header->policy[sizeof(header->policy) - 1]) {
+    fprintf(stderr, "ERROR in file contents\n%s is not a version %u checkpoint\n", filename, CHECKPOINT_VERSION);
     exit(EXIT_FAILURE);
   }
-  size_t first_digit = strcspn(line, "1234567890");
-  char* token = &line[first_digit];
-  size_t after_last_digit = strspn(line, "1234567890");
-  line[after_last_digit] = '\0';
-  char* endptr = NULL;
-  TIME_SLICE = INITIAL_TIME_SLICE = strtoul(token, &endptr, 10);
-  if ('\0' != *endptr) {
-    perror("ERROR in file contents");
-    fprintf(stderr, "Failed to convert string \"%s\" to TIME_SLICE value\n", token);
-    fclose(file);
+  return file;
+}
+
+/* reads the checkpoint's parameters as a malloc'd string, or NULL if it has none */
+static char* read_checkpoint_params(FILE* file, const char* filename, const struct checkpoint_header* header) {
+  if (0 == header->params_length)
+    return NULL;
+  char* params = malloc(header->params_length + 1);
+  assert(NULL != params);
+  read_checkpoint(file, filename, params, 1, header->params_length);
+  params[header->params_length] = '\0';
+  return params;
+}
+
+
+const struct sched_policy* sim_checkpoint_policy(const char* filename, char** params, unsigned int* num_cpus) {
+  struct checkpoint_header header;
+  FILE* file = open_checkpoint(filename, &header);
+  const struct sched_policy* policy = find_sched_policy(header.policy);
+  if (NULL == policy) {
+    fprintf(stderr, "ERROR: %s is a checkpoint of the %s policy, which this build does not have\n",
+            filename, header.policy);
     exit(EXIT_FAILURE);
   }
+  *params = read_checkpoint_params(file, filename, &header);
+  *num_cpus = header.num_cpus;
+  fclose(file);
+  return policy;
+}
+
 
-  // Get the number of processes
-  if (NULL == fgets(line, 1024, file)) {
-    perror("ERROR reading file");
-    fclose(file);
+void sim_restore_file(struct sim_ctx* ctx, const char* filename) {
+  assert(NULL == ctx->process_list); // one workload per simulation
+  struct checkpoint_header header;
+  FILE* file = open_checkpoint(filename, &header);
+  if (0 != strcmp(header.policy, ctx->policy->name) || NULL == ctx->policy->restore) {
+    fprintf(stderr, "ERROR: %s is a checkpoint of the %s policy, which the %s policy cannot resume\n",
+            filename, header.policy, ctx->policy->name);
     exit(EXIT_FAILURE);
   }
-  first_digit = strcspn(line, "1234567890");
-  token = &line[first_digit];
-  after_last_digit = strspn(line, "1234567890");
-  line[after_last_digit] = '\0';
-  endptr = NULL;
-  num_procs = strtoul(token, &endptr, 10);
-  if ('\0' != *endptr) {
-    perror("ERROR in file contents");
-    fprintf(stderr, "Failed to convert string \"%s\" to NUM_PROCS value\n", token);
-    fclose(file);
+  if (header.num_cpus != ctx->num_cpus) {
+    fprintf(stderr, "ERROR: %s was checkpointed on %u CPUs, not %u\n", filename, header.num_cpus, ctx->num_cpus);
     exit(EXIT_FAILURE);
   }
+  // the arrays have to fit in the file before they are allocated
+  fseek(file, 0, SEEK_END);
+  uint64_t size = ftell(file);
+  fseek(file, sizeof(header), SEEK_SET);
+  if (header.num_bursts > size / sizeof(uint32_t) ||
+      sizeof(header) + header.params_length + (uint64_t)header.num_cpus * sizeof(struct checkpoint_cpu) +
+      (uint64_t)header.num_procs * sizeof(struct checkpoint_process) + header.num_bursts * sizeof(uint32_t) +
+      (uint64_t)header.num_queued_events * sizeof(struct checkpoint_event) + sizeof(uint64_t) > size) {
+    fprintf(stderr, "ERROR reading file: checkpoint %s is truncated\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  ctx->restored_params = read_checkpoint_params(file, filename, &header);
+  if (NULL == ctx->policy_params)
+    ctx->policy_params = ctx->restored_params;
+
+  ctx->workload.time_slice = header.workload_time_slice;
+  ctx->initial_time_slice = header.initial_time_slice;
+  ctx->time_slice = header.time_slice;
+  if (0 != ctx->time_slice_override) {
+    // a policy running on the initial time slice carries on with the new one
+    if (ctx->time_slice == ctx->initial_time_slice)
+      ctx->time_slice = ctx->time_slice_override;
+    ctx->initial_time_slice = ctx->time_slice_override;
+  }
+  if (0 == ctx->switch_cost && 0 == ctx->cache_penalty) {
+    ctx->switch_cost = header.switch_cost;
+    ctx->cache_penalty = header.cache_penalty;
+    ctx->cache_window = header.cache_window;
+  }
+  ctx->switch_overhead = header.switch_overhead;
+  ctx->current_time = header.current_time;
+  ctx->num_events = header.num_events;
+  ctx->num_procs = header.num_live_procs;
+
+  // room for a finished CPU burst ahead of every process that is in the middle
+  // of an I/O burst, so burst types alternate from index 0 as when loaded
+  alloc_workload(&ctx->workload, header.num_procs, header.num_bursts + header.num_procs);
+  ctx->process_list = malloc((header.num_procs + 1) * sizeof(struct process*));
+  assert(NULL != ctx->process_list);
+  for (unsigned int pid = 0; pid <= header.num_procs; ++pid)
+    ctx->process_list[pid] = (pid < header.num_procs) ? &ctx->workload.procs[pid] : NULL;
+
+  struct checkpoint_cpu* cpus = malloc(header.num_cpus * sizeof(struct checkpoint_cpu));
+  struct checkpoint_process* procs = malloc((header.num_procs + 1) * sizeof(struct checkpoint_process));
+  assert(NULL != cpus && NULL != procs);
+  read_checkpoint(file, filename, cpus, sizeof(struct checkpoint_cpu), header.num_cpus);
+  read_checkpoint(file, filename, procs, sizeof(struct checkpoint_process), header.num_procs);
+  int bad = 0;
+  for (unsigned int cpu = 0; cpu < header.num_cpus; ++cpu) {
+    bad |= (cpus[cpu].running < -1 || cpus[cpu].running >= (int32_t)header.num_procs);
+    ctx->cpus[cpu].running = (bad || -1 == cpus[cpu].running) ? NULL : ctx->process_list[cpus[cpu].running];
+    ctx->cpus[cpu].time_started = cpus[cpu].time_started;
+    ctx->cpus[cpu].num_dispatches = cpus[cpu].num_dispatches;
+  }
 
-  // Load the processes
-  process_list = malloc((num_procs + 1) * sizeof(struct process*));
-  memset(process_list, 0, (num_procs + 1) * sizeof(struct process*));
-
-  for (unsigned int pid = 0; pid < num_procs; ++pid) {
-    process_list[pid] = malloc(sizeof(struct process));
-    memset(process_list[pid], 0, sizeof(struct process));
-    process_list[pid]->pid = pid;
-    process_list[pid]->state = NOT_ARRIVED;
+  uint64_t bursts_read = 0;
+  time_ticks_t* next_burst = ctx->workload.bursts;
+  for (unsigned int pid = 0; pid < header.num_procs && !bad; ++pid) {
+    struct process* proc = ctx->process_list[pid];
+    proc->pid = pid;
+    proc->tickets = procs[pid].tickets;
+    proc->arrival_time = procs[pid].arrival_time;
+    proc->cpu = procs[pid].cpu;
+    proc->state = procs[pid].state;
+    COUNT(ctx->num_ready += (READY == proc->state));
+    proc->last_dispatch = procs[pid].last_dispatch;
+    bad |= (proc->cpu < -1 || proc->cpu >= (int)header.num_cpus || proc->state > TERMINATED);
+    bad |= (procs[pid].num_bursts > header.num_bursts - bursts_read || procs[pid].first_burst_type > IO_BURST);
+    if (bad)
+      break;
+    proc->bursts = next_burst;
+    proc->current_burst = (IO_BURST == procs[pid].first_burst_type) ? 1 : 0;
+    proc->num_bursts = proc->current_burst + procs[pid].num_bursts;
+    read_checkpoint(file, filename, &proc->bursts[proc->current_burst], sizeof(time_ticks_t), procs[pid].num_bursts);
+    next_burst += proc->num_bursts;
+    bursts_read += procs[pid].num_bursts;
+  }
+  bad |= (bursts_read != header.num_bursts || header.num_queued_events > header.num_procs);
+  free(cpus);
+  free(procs);
+
+  for (unsigned int i = 0; i < header.num_queued_events && !bad; ++i) {
+    struct checkpoint_event event;
+    read_checkpoint(file, filename, &event, sizeof(event), 1);
+    bad |= (event.pid >= header.num_procs || event.type > FINISH_TIME_SLICE ||
+            ctx->process_list[event.pid]->event.queued);
+    if (!bad)
+      new_event(ctx->events, event.time, event.type, ctx->process_list[event.pid]);
+  }
 
-    if (NULL == fgets(line, 1024, file)) {
-      perror("ERROR reading file");
-      fclose(file);
+  if (!bad) {
+    uint64_t policy_length;
+    read_checkpoint(file, filename, &policy_length, sizeof(policy_length), 1);
+    if (policy_length > size - ftell(file)) {
+      fprintf(stderr, "ERROR reading file: checkpoint %s is truncated\n", filename);
       exit(EXIT_FAILURE);
     }
+    char* policy_data = malloc(policy_length + 1);
+    assert(NULL != policy_data);
+    read_checkpoint(file, filename, policy_data, 1, policy_length);
+    // the policy cannot read past its own part
+    FILE* policy_file = fmemopen(policy_data, policy_length, "rb");
+    assert(NULL != policy_file);
+    // the policy may look at the processes and the time while it restores
+    struct sim_ctx* previous = active;
+    active = ctx;
+    ctx->policy_state = ctx->policy->restore(ctx->policy_params, policy_file);
+    active = previous;
+    fclose(policy_file);
+    free(policy_data);
+    bad = (NULL == ctx->policy_state);
+  }
 
-    token = strtok(line, WHITESPACE_DELIM);
-    if (NULL == token) {
-      perror("ERROR in file contents");
-      fprintf(stderr, "No number of tickets found on process line: %s\n", line);
-      fclose(file);
-      exit(EXIT_FAILURE);
-    }
-    endptr = NULL;
-    process_list[pid]->tickets = strtoul(token, &endptr, 10);
-    if ('\0' != *endptr) {
-      perror("ERROR in file contents");
-      fprintf(stderr, "Failed to convert string \"%s\" to number of tickets\n", token);
-      fclose(file);
-      exit(EXIT_FAILURE);
-    }
+  if (!bad && header.has_metrics) {
+    struct metrics* metrics = metrics_restore(file, header.num_procs);
+    bad = (NULL == metrics);
+    if (ctx->track_metrics)
+      ctx->metrics = metrics;
+    else
+      metrics_destroy(metrics);
+  } else if (!bad && ctx->track_metrics) {
+    fprintf(stderr, "ERROR: %s was checkpointed without metrics (checkpoint with --metrics to keep them)\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  fclose(file);
+  if (bad) {
+    fprintf(stderr, "ERROR in file contents\n%s is not a consistent checkpoint\n", filename);
+    exit(EXIT_FAILURE);
+  }
 
-    token = strtok(NULL, WHITESPACE_DELIM);
-    if (NULL == token) {
-      perror("ERROR in file contents");
-      fprintf(stderr, "No arrival time found on process line: %s\n", line);
-      fclose(file);
-      exit(EXIT_FAILURE);
-    }
-    endptr = NULL;
-    process_list[pid]->arrival_time = strtoul(token, &endptr, 10);
-    if ('\0' != *endptr) {
-      perror("ERROR in file contents");
-      fprintf(stderr, "Failed to convert string \"%s\" to arrival time\n", token);
-      fclose(file);
-      exit(EXIT_FAILURE);
-    }
+  if (0 != ctx->checkpoint_every)
+    ctx->next_checkpoint = header.checkpoint_time - header.checkpoint_time % ctx->checkpoint_every + ctx->checkpoint_every;
+}
 
-    // the list of bursts starts as a CPU burst,
-    // and then alternates between CPU and I/O bursts
-    burst_type_t burst_type = CPU_BURST;
-    struct burst** next_burst_ptr = &process_list[pid]->current_burst;
-    token = strtok(NULL, WHITESPACE_DELIM);
-
-    while (NULL != token) {
-      // create burst
-      struct burst* next_burst = malloc(sizeof(struct burst));
-      memset(next_burst, 0, sizeof(struct burst));
-
-      // populate burst info
-      next_burst->type = burst_type;
-      endptr = NULL;
-      next_burst->remaining_time = strtoul(token, &endptr, 10);
-      if ('\0' != *endptr) {
-        perror("ERROR in file contents");
-        fprintf(stderr, "Failed to convert string \"%s\" to burst time\n", token);
-        fclose(file);
-        exit(EXIT_FAILURE);
-      }
 
-      // point to burst, then update next pointer
-      *next_burst_ptr = next_burst;
-      next_burst_ptr = &next_burst->next_burst;
+time_ticks_t sim_run(struct sim_ctx* ctx, struct sim_stats* stats) {
+  assert(NULL != ctx->process_list);
+  struct sim_ctx* previous = active;
+  active = ctx;
+
+  if (NULL == ctx->policy_state) // unless sim_restore_file() restored it
+    ctx->policy_state = ctx->policy->init(ctx->policy_params);
+  if (ctx->batch_events) {
+    // room for an event per process, which is as many as one time can have
+    ctx->batch_capacity = (ctx->workload.num_procs > ctx->slot_capacity) ? ctx->workload.num_procs : ctx->slot_capacity;
+    if (0 == ctx->batch_capacity)
+      ctx->batch_capacity = 1;
+    ctx->batch = malloc(ctx->batch_capacity * sizeof(struct sched_event));
+    assert(NULL != ctx->batch);
+    for (unsigned int cpu = 0; cpu < ctx->num_cpus; ++cpu)
+      ctx->cpus[cpu].switched_by = UINT_MAX;
+  }
+  unsigned long setup_allocations = get_num_allocations();
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  time_ticks_t end_time = event_loop(ctx);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  unsigned long loop_allocations = get_num_allocations() - setup_allocations;
+  // INVARIANT: event queue should now be empty
+  trace_event(ctx->trace, TRACE_FINISHED, end_time, -1, 0);
+  ctx->policy->cleanup(ctx->policy_state);
+  ctx->policy_state = NULL;
+  free(ctx->batch);
+  ctx->batch = NULL;
+
+  active = previous;
+  if (NULL != stats) {
+    stats->num_procs = (NULL != ctx->stream) ? ctx->num_streamed : ctx->workload.num_procs;
+    stats->num_events = ctx->num_events;
+    stats->setup_allocations = setup_allocations;
+    stats->loop_allocations = loop_allocations;
+    stats->loop_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    stats->switch_overhead = ctx->switch_overhead;
+    stats->overhead_percent = end_time ? 100.0 * ctx->switch_overhead / ((double)end_time * ctx->num_cpus) : 0.0;
+    stats->counters = ctx->counters;
+    stats->counters.insert_depth = event_queue_stats(ctx->events)->insert_depth;
+    stats->counters.remove_scan = event_queue_stats(ctx->events)->remove_scan;
+  }
+  return end_time;
+}
 
-      // change burst type for next burst
-      if (CPU_BURST == burst_type)
-        burst_type = IO_BURST;
-      else
-        burst_type = CPU_BURST;
 
-      // get the next burst time token
-      token = strtok(NULL, WHITESPACE_DELIM);
-    }
+void sim_report_metrics(const struct sim_ctx* ctx, FILE* file) {
+  metrics_report(ctx->metrics, file, ctx->current_time);
+}
 
-    new_event(process_list[pid]->arrival_time, ARRIVAL, process_list[pid]);
-  }
 
-  fclose(file);
+void sim_report_stats(const struct sim_stats* stats, FILE* file) {
+#ifdef SIM_STATS
+  static const char* event_names[NUM_EVENT_TYPES] = {"arrival", "finish cpu", "finish i/o", "finish time slice"};
+  const struct sim_counters* counters = &stats->counters;
+  fprintf(file, "stats:\n");
+  fprintf(file, "  events popped    %lu:", stats->num_events);
+  for (int type = 0; type < NUM_EVENT_TYPES; ++type)
+    fprintf(file, "%s %s %lu", (0 == type) ? "" : ",", event_names[type], counters->events[type]);
+  fprintf(file, "\n");
+  fprintf(file, "  new_event        %lu, depth mean %.2f, max %lu\n", counters->insert_depth.samples,
+          sample_count_mean(&counters->insert_depth), counters->insert_depth.max);
+  fprintf(file, "  remove_events    %lu, scanned mean %.2f, max %lu\n", counters->remove_scan.samples,
+          sample_count_mean(&counters->remove_scan), counters->remove_scan.max);
+  fprintf(file, "  context switches %lu requested, %lu rejected\n",
+          counters->switches_requested, counters->switches_rejected);
+  fprintf(file, "  ready queue      length mean %.2f, max %lu\n",
+          sample_count_mean(&counters->ready_length), counters->ready_length.max);
+  fprintf(file, "  allocations      %lu before the event loop, %lu in the event loop\n",
+          stats->setup_allocations, stats->loop_allocations);
+#else
+  (void)stats;
+  fprintf(file, "stats: not counted (built with NDEBUG)\n");
+#endif // SIM_STATS
 }
 
 
-void cleanup_processes() {
-  for (unsigned int i = 0; NULL != process_list[i]; ++i) {
-    if (TERMINATED != process_list[i]->state) {
-      printf("ERROR: Finishing simulation while process %d is not TERMINATED (status=%d)\n",
-             process_list[i]->pid, process_list[i]->state);
+void sim_summarize_metrics(const struct sim_ctx* ctx, struct metrics_summary* summary) {
+  metrics_summarize(ctx->metrics, ctx->current_time, summary);
+}
+
+
+void sim_destroy(struct sim_ctx* ctx) {
+  if (NULL != ctx->process_list) {
+    for (unsigned int i = 0; NULL != ctx->process_list[i]; ++i) {
+      if (TERMINATED != ctx->process_list[i]->state) {
+        trace_event(ctx->trace, TRACE_NOT_TERMINATED, ctx->current_time,
+                    ctx->process_list[i]->pid, ctx->process_list[i]->state);
 #ifdef DEBUG
-      print_process(process_list[i]);
+        print_process(ctx->process_list[i]);
 #endif // DEBUG
-    }
-
-    struct burst* this_burst = process_list[i]->current_burst;
-    while (NULL != this_burst) {
-      fprintf(stderr, "WARNING: Freeing burst type %d with remaining time %d on process %d\n",
-              this_burst->type, this_burst->remaining_time, process_list[i]->pid);
+      }
 
-      struct burst* prev_burst = this_burst;
-      this_burst = this_burst->next_burst;
-      free(prev_burst);
+      const struct process* proc = ctx->process_list[i];
+      for (unsigned int burst = proc->current_burst; burst < proc->num_bursts; ++burst) {
+        fprintf(stderr, "WARNING: Freeing burst type %d with remaining time %d on process %d\n",
+                burst % 2, proc->bursts[burst], proc->pid);
+      }
     }
-
-    free(process_list[i]);
-  }
-  free(process_list);
-  process_list = NULL;
-}
-
-
-int main(int argc, char** argv) {
-  if (argc <= 1) {
-    fprintf(stderr, "Usage: ./simulation filename.proc\n");
-    return EXIT_FAILURE;
+    if (NULL != ctx->stream) {
+      for (unsigned int pid = 0; pid < ctx->workload.num_procs; ++pid) {
+        struct stream_slot* slot = (struct stream_slot*)ctx->process_list[pid];
+        free(slot->bursts);
+        free(slot);
+      }
+      free(ctx->free_pids);
+      close_workload_stream(ctx->stream);
+    }
+    free(ctx->process_list);
+    free_workload(&ctx->workload);
+    metrics_destroy(ctx->metrics);
   }
-  load_file(argv[1]);
-
-  sched_init();
-  time_ticks_t end_time = event_loop();
-  // INVARIANT: event queue should now be empty
-  printf("Finished at time %d\n", end_time);
-  sched_cleanup();
-
-  cleanup_processes();
-  return EXIT_SUCCESS;
+  if (NULL != ctx->policy_state) // restored, but never run
+    ctx->policy->cleanup(ctx->policy_state);
+  event_queue_destroy(ctx->events);
+  trace_destroy(ctx->trace);
+  free(ctx->restored_params);
+  free(ctx->cpus);
+  free(ctx);
 }
-
@@ -0,0 +1,141 @@
+#include "trace.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRACE_BUFFER_RECORDS (1 << 16) // 768 KiB
+
+struct trace {
+  trace_mode_t mode;
+  FILE* file;
+  struct trace_record* buffer; // TRACE_BUFFER_RECORDS records in binary mode
+  unsigned int buffered;
+};
+
+
+/* writes all of data to the trace's file, bypassing stdio */
+static void write_out(struct trace* trace, const void* data, size_t size) {
+  const char* p = data;
+  while (size > 0) {
+    ssize_t written = write(fileno(trace->file), p, size);
+    if (-1 == written) {
+      if (EINTR == errno)
+        continue;
+      perror("ERROR writing trace");
+      exit(EXIT_FAILURE);
+    }
+    p += written;
+    size -= written;
+  }
+}
+
+
+struct trace* trace_create(trace_mode_t mode, FILE* file) {
+  struct trace* trace = calloc(1, sizeof(struct trace));
+  assert(NULL != trace);
+  trace->mode = mode;
+  trace->file = file;
+  if (TRACE_BINARY == mode) {
+    trace->buffer = malloc(TRACE_BUFFER_RECORDS * sizeof(struct trace_record));
+    assert(NULL != trace->buffer);
+
+    struct trace_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(struct trace_record);
+    fflush(file); // keep anything already written through stdio in front
+    write_out(trace, &header, sizeof(header));
+  }
+  return trace;
+}
+
+
+void trace_event(struct trace* trace, trace_type_t type, time_ticks_t time, pid_t pid, int arg) {
+  struct trace_record record = {time, pid, type, arg};
+  switch (trace->mode) {
+  case TRACE_BINARY:
+    trace->buffer[trace->buffered++] = record;
+    if (TRACE_BUFFER_RECORDS == trace->buffered)
+      trace_flush(trace);
+    break;
+  case TRACE_NONE:
+    if (type < TRACE_FINISHED)
+      break;
+    // fall through
+  case TRACE_TEXT:
+    print_trace_record(trace->file, &record);
+    break;
+  }
+}
+
+
+void trace_flush(struct trace* trace) {
+  if (TRACE_BINARY == trace->mode) {
+    write_out(trace, trace->buffer, trace->buffered * sizeof(struct trace_record));
+    trace->buffered = 0;
+  } else {
+    fflush(trace->file);
+  }
+}
+
+
+void trace_destroy(struct trace* trace) {
+  trace_flush(trace);
+  free(trace->buffer);
+  free(trace);
+}
+
+
+void print_trace_record(FILE* file, const struct trace_record* record) {
+  int time = record->time;
+  switch (record->type) {
+  case TRACE_ARRIVED:
+    fprintf(file, "(t=%d) proc %d arrived\n", time, record->pid);
+    break;
+  case TRACE_RUNNING:
+    fprintf(file, "(t=%d) running proc %d\n", time, record->pid);
+    break;
+  case TRACE_BLOCKED:
+    fprintf(file, "(t=%d) proc %d blocked for I/O\n", time, record->pid);
+    break;
+  case TRACE_FINISHED_IO:
+    fprintf(file, "(t=%d) proc %d finished I/O\n", time, record->pid);
+    break;
+  case TRACE_IDLE:
+    fprintf(file, "(t=%d) idle\n", time);
+    break;
+  case TRACE_RUNNING_ON:
+    fprintf(file, "(t=%d) running proc %d on cpu %d\n", time, record->pid, record->arg);
+    break;
+  case TRACE_IDLE_ON:
+    fprintf(file, "(t=%d) cpu %d idle\n", time, record->arg);
+    break;
+  case TRACE_FINISHED:
+    fprintf(file, "Finished at time %d\n", time);
+    break;
+  case TRACE_INVALID_PID:
+    fprintf(file, "WARNING: invalid pid value %d\n", record->pid);
+    break;
+  case TRACE_NOT_READY:
+    fprintf(file, "WARNING: process %d is not in the READY state\n", record->pid);
+    break;
+  case TRACE_ALREADY_RUNNING:
+    fprintf(file, "WARNING: attempt to context switch to currently running process (pid=%d)\n", record->pid);
+    break;
+  case TRACE_NOT_TERMINATED:
+    fprintf(file, "ERROR: Finishing simulation while process %d is not TERMINATED (status=%d)\n",
+            record->pid, record->arg);
+    break;
+  case TRACE_INVALID_CPU:
+    fprintf(file, "WARNING: invalid cpu value %d\n", record->pid);
+    break;
+  case TRACE_RUNNING_ELSEWHERE:
+    fprintf(file, "WARNING: process %d is already running on cpu %d\n", record->pid, record->arg);
+    break;
+  default:
+    fprintf(stderr, "ERROR: Unrecognized trace record type %d at time %u\n", record->type, record->time);
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "types.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/* Simulator output.  Everything a simulation reports goes through
+ * trace_event() on its own struct trace, which, depending on --trace, prints
+ * it as text (the default), appends a fixed-size record to a large write
+ * buffer (binary, read back with dumptrace), or drops the per-event lines and
+ * prints only warnings, errors and the final time (none). */
+typedef enum {TRACE_TEXT, TRACE_BINARY, TRACE_NONE} trace_mode_t;
+
+typedef enum {
+  // per-event lines, dropped by --trace=none
+  TRACE_ARRIVED,
+  TRACE_RUNNING,
+  TRACE_BLOCKED,
+  TRACE_FINISHED_IO,
+  TRACE_IDLE,
+  TRACE_RUNNING_ON,      // arg = cpu; used instead of the two above with --cpus > 1
+  TRACE_IDLE_ON,
+  // always reported
+  TRACE_FINISHED,        // time = end of the simulation
+  TRACE_INVALID_PID,     // context_switch() warnings
+  TRACE_NOT_READY,
+  TRACE_ALREADY_RUNNING,
+  TRACE_NOT_TERMINATED,  // arg = state of the process
+  TRACE_INVALID_CPU,     // pid = the invalid cpu value
+  TRACE_RUNNING_ELSEWHERE, // arg = cpu it is running on
+  NUM_TRACE_TYPES
+} trace_type_t;
+
+/* Binary trace layout, in native byte order: a struct trace_header followed
+ * by struct trace_record entries until the end of the file. */
+#define TRACE_MAGIC "SCHEDTRC"
+#define TRACE_VERSION 2
+
+struct trace_header {
+  char magic[8]; // TRACE_MAGIC, not NUL-terminated
+  uint32_t version;
+  uint32_t record_size;
+};
+
+struct trace_record {
+  uint32_t time;
+  int32_t pid;
+  uint16_t type;
+  uint16_t arg;
+};
+
+struct trace;
+
+/* trace_create
+ *   starts a trace written to file in the given mode; a binary trace starts
+ *   with its header
+ */
+struct trace* trace_create(trace_mode_t mode, FILE* file);
+
+/* trace_event
+ *   reports one thing that happened at time to process pid
+ */
+void trace_event(struct trace* trace, trace_type_t type, time_ticks_t time, pid_t pid, int arg);
+
+/* trace_flush
+ *   writes out anything still buffered
+ */
+void trace_flush(struct trace* trace);
+
+/* trace_destroy
+ *   flushes and releases the trace (but does not close its file)
+ */
+void trace_destroy(struct trace* trace);
+
+/* print_trace_record
+ *   prints a record exactly as the text mode would
+ */
+void print_trace_record(FILE* file, const struct trace_record* record);
+
+#endif /* _TRACE_H_ */
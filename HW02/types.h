@@ -0,0 +1,7 @@
+#ifndef _TYPES_H_
+#define _TYPES_H_
+
+typedef unsigned int time_ticks_t;
+typedef int pid_t;
+
+#endif /* _TYPES_H_ */
@@ -0,0 +1,454 @@
+#include "workload.h"
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* workgen
+ *   generates synthetic workloads for scaling studies, as a text .proc file or
+ *   (with --binary, or an output name ending in .procb) a binary .procb file.
+ *
+ *   ./workgen [options] output.proc     ("-" writes to stdout)
+ *
+ * Output is streamed: nothing is kept per process, so memory use does not
+ * depend on the size of the workload.  Every process draws from its own random
+ * stream derived from (seed, pid) and arrivals come from a separate stream, so
+ * the text and binary outputs of one seed describe the same workload, and the
+ * binary writer can walk the processes twice (burst counts for the table, then
+ * the bursts themselves) without storing anything.
+ *
+ * Distributions are written NAME:ARG[:ARG...]:
+ *   const:N                  always N
+ *   uniform:LO:HI            uniform integer in [LO, HI]
+ *   exp:MEAN                 exponential
+ *   bimodal:SHORT:LONG:P     exponential with mean LONG with probability P,
+ *                            otherwise exponential with mean SHORT
+ *   pareto:MIN:ALPHA         heavy tailed, P(X > x) = (MIN / x)^ALPHA
+ * Burst lengths and tickets are at least 1 and are capped at --max-burst.
+ */
+
+#define MAX_DIST_ARGS 3
+
+typedef enum {
+  DIST_CONST,
+  DIST_UNIFORM,
+  DIST_EXP,
+  DIST_BIMODAL,
+  DIST_PARETO
+} dist_kind_t;
+
+static const struct {
+  const char* name;
+  unsigned int num_args;
+} dist_kinds[] = {
+  [DIST_CONST] = {"const", 1},
+  [DIST_UNIFORM] = {"uniform", 2},
+  [DIST_EXP] = {"exp", 1},
+  [DIST_BIMODAL] = {"bimodal", 3},
+  [DIST_PARETO] = {"pareto", 2},
+};
+
+struct dist {
+  dist_kind_t kind;
+  double args[MAX_DIST_ARGS];
+};
+
+typedef enum {
+  ARRIVALS_POISSON,
+  ARRIVALS_BURSTY
+} arrivals_kind_t;
+
+struct config {
+  unsigned int num_procs;
+  time_ticks_t time_slice;
+  arrivals_kind_t arrivals;
+  double mean_gap;        // mean ticks between arrivals (between groups when bursty)
+  unsigned int group_size; // mean number of processes arriving together when bursty
+  struct dist cpu;
+  struct dist io;
+  struct dist tickets;
+  double mean_cpu_bursts; // per process, geometrically distributed
+  unsigned long max_burst;
+  uint64_t seed;
+  int binary;
+};
+
+
+/*********************
+ * Random generation *
+ *********************/
+
+static uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+static uint64_t next_random(uint64_t* state) {
+  // xorshift64*
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717ULL;
+}
+
+/* uniform in [0, 1) */
+static double next_unit(uint64_t* state) {
+  return (next_random(state) >> 11) * 0x1p-53;
+}
+
+static double next_exponential(uint64_t* state, double mean) {
+  return -mean * log1p(-next_unit(state));
+}
+
+/* the random stream used for one process's burst count, tickets and bursts */
+static uint64_t process_stream(const struct config* config, pid_t pid) {
+  uint64_t state = splitmix64(config->seed ^ splitmix64((uint64_t)pid + 1));
+  return (0 == state) ? 1 : state;
+}
+
+static double sample(const struct dist* dist, uint64_t* state) {
+  const double* a = dist->args;
+  switch (dist->kind) {
+  case DIST_CONST:
+    return a[0];
+  case DIST_UNIFORM:
+    return a[0] + (double)(next_random(state) % (uint64_t)(a[1] - a[0] + 1));
+  case DIST_EXP:
+    return next_exponential(state, a[0]);
+  case DIST_BIMODAL:
+    return next_exponential(state, (next_unit(state) < a[2]) ? a[1] : a[0]);
+  case DIST_PARETO:
+    return a[0] / pow(1.0 - next_unit(state), 1.0 / a[1]);
+  }
+  return 0;
+}
+
+/* draws a tick count in [1, max] */
+static uint32_t sample_ticks(const struct dist* dist, uint64_t* state, unsigned long max) {
+  double value = ceil(sample(dist, state));
+  if (value < 1)
+    return 1;
+  if (value > max)
+    return max;
+  return value;
+}
+
+/* number of CPU bursts, at least 1 with the configured mean */
+static unsigned long sample_cpu_bursts(const struct config* config, uint64_t* state) {
+  if (config->mean_cpu_bursts <= 1)
+    return 1;
+  double p = 1.0 / config->mean_cpu_bursts;
+  double count = 1 + floor(log1p(-next_unit(state)) / log1p(-p));
+  return (count > UINT32_MAX / 2) ? UINT32_MAX / 2 : (unsigned long)count;
+}
+
+/* arrival times are drawn in pid order from their own stream */
+struct arrival_stream {
+  uint64_t state;
+  double time;
+  unsigned int group_left;
+};
+
+static void init_arrivals(struct arrival_stream* arrivals, const struct config* config) {
+  arrivals->state = splitmix64(config->seed);
+  if (0 == arrivals->state)
+    arrivals->state = 1;
+  arrivals->time = 0;
+  arrivals->group_left = 0;
+}
+
+static time_ticks_t next_arrival(struct arrival_stream* arrivals, const struct config* config, pid_t pid) {
+  if (0 != pid) {
+    if (ARRIVALS_POISSON == config->arrivals) {
+      arrivals->time += next_exponential(&arrivals->state, config->mean_gap);
+    } else if (0 == arrivals->group_left) {
+      // a new group: a long gap, then a geometrically sized run of arrivals
+      // spread over a tick or two
+      arrivals->time += next_exponential(&arrivals->state, config->mean_gap);
+      arrivals->group_left = 1 + floor(next_exponential(&arrivals->state, config->group_size - 0.5));
+    } else {
+      arrivals->time += next_exponential(&arrivals->state, 0.5);
+      --arrivals->group_left;
+    }
+  }
+  if (arrivals->time > UINT_MAX) {
+    fprintf(stderr, "ERROR: arrival times overflow at process %d; lower --procs or the arrival gap\n", pid);
+    exit(EXIT_FAILURE);
+  }
+  return arrivals->time;
+}
+
+
+/***********
+ * Writers *
+ ***********/
+
+static void check_write(int ok) {
+  if (!ok) {
+    perror("ERROR writing workload");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void put_uint(FILE* out, unsigned long value, char separator) {
+  char buffer[24];
+  char* p = buffer + sizeof(buffer);
+  *--p = separator;
+  do {
+    *--p = '0' + value % 10;
+    value /= 10;
+  } while (0 != value);
+  size_t length = buffer + sizeof(buffer) - p;
+  check_write(length == fwrite(p, 1, length, out));
+}
+
+static unsigned long write_text(FILE* out, const struct config* config) {
+  struct arrival_stream arrivals;
+  init_arrivals(&arrivals, config);
+  unsigned long num_bursts = 0;
+
+  put_uint(out, config->time_slice, '\n');
+  put_uint(out, config->num_procs, '\n');
+  for (unsigned int pid = 0; pid < config->num_procs; ++pid) {
+    uint64_t state = process_stream(config, pid);
+    unsigned long cpu_bursts = sample_cpu_bursts(config, &state);
+    put_uint(out, sample_ticks(&config->tickets, &state, config->max_burst), ' ');
+    put_uint(out, next_arrival(&arrivals, config, pid), ' ');
+    for (unsigned long i = 0; i < 2 * cpu_bursts - 1; ++i) {
+      const struct dist* dist = (i % 2) ? &config->io : &config->cpu;
+      put_uint(out, sample_ticks(dist, &state, config->max_burst), (i == 2 * cpu_bursts - 2) ? '\n' : ' ');
+    }
+    num_bursts += 2 * cpu_bursts - 1;
+  }
+  return num_bursts;
+}
+
+static unsigned long write_binary(FILE* out, const struct config* config) {
+  struct procb_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, PROCB_MAGIC, sizeof(header.magic));
+  header.version = PROCB_VERSION;
+  header.time_slice = config->time_slice;
+  header.num_procs = config->num_procs;
+  // the burst count is the first draw of each process's stream
+  for (unsigned int pid = 0; pid < config->num_procs; ++pid) {
+    uint64_t state = process_stream(config, pid);
+    header.num_bursts += 2 * sample_cpu_bursts(config, &state) - 1;
+  }
+  check_write(1 == fwrite(&header, sizeof(header), 1, out));
+
+  struct arrival_stream arrivals;
+  init_arrivals(&arrivals, config);
+  uint64_t first_burst = 0;
+  for (unsigned int pid = 0; pid < config->num_procs; ++pid) {
+    uint64_t state = process_stream(config, pid);
+    struct procb_process entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.num_bursts = 2 * sample_cpu_bursts(config, &state) - 1;
+    entry.tickets = sample_ticks(&config->tickets, &state, config->max_burst);
+    entry.arrival_time = next_arrival(&arrivals, config, pid);
+    entry.first_burst = first_burst;
+    first_burst += entry.num_bursts;
+    check_write(1 == fwrite(&entry, sizeof(entry), 1, out));
+  }
+
+  for (unsigned int pid = 0; pid < config->num_procs; ++pid) {
+    uint64_t state = process_stream(config, pid);
+    unsigned long num_bursts = 2 * sample_cpu_bursts(config, &state) - 1;
+    sample_ticks(&config->tickets, &state, config->max_burst);
+    for (unsigned long i = 0; i < num_bursts; ++i) {
+      uint32_t length = sample_ticks((i % 2) ? &config->io : &config->cpu, &state, config->max_burst);
+      check_write(1 == fwrite(&length, sizeof(length), 1, out));
+    }
+  }
+  return header.num_bursts;
+}
+
+
+/********************
+ * Argument parsing *
+ ********************/
+
+static void usage() {
+  fprintf(stderr,
+          "Usage: ./workgen [options] output.proc|output.procb|-\n"
+          "  --procs=N               number of processes (default 1000)\n"
+          "  --time-slice=T          time slice written to the file (default 20)\n"
+          "  --arrivals=KIND:GAP[:N] poisson:GAP, or bursty:GAP:N for groups of ~N\n"
+          "                          processes every ~GAP ticks (default poisson:10)\n"
+          "  --cpu=DIST              CPU burst lengths (default exp:20)\n"
+          "  --io=DIST               I/O burst lengths (default exp:40)\n"
+          "  --cpu-bursts=MEAN       mean CPU bursts per process (default 3)\n"
+          "  --tickets=DIST          stride tickets (default uniform:1:10)\n"
+          "  --max-burst=T           cap on burst lengths and tickets (default 1000000)\n"
+          "  --seed=S                random seed (default 1)\n"
+          "  --binary                write .procb even if the name does not end in .procb\n"
+          "DIST is const:N, uniform:LO:HI, exp:MEAN, bimodal:SHORT:LONG:P or pareto:MIN:ALPHA\n");
+}
+
+static void bad_argument(const char* option, const char* value) {
+  fprintf(stderr, "ERROR: bad value \"%s\" for --%s\n", value, option);
+  usage();
+  exit(EXIT_FAILURE);
+}
+
+/* splits "name:a:b" into the name and up to max_args numbers; returns the
+ * number of arguments or -1 if one is not a number */
+static int split_spec(const char* spec, char* name, size_t name_size, double* args, int max_args) {
+  size_t length = strcspn(spec, ":");
+  if (length >= name_size)
+    return -1;
+  memcpy(name, spec, length);
+  name[length] = '\0';
+
+  int num_args = 0;
+  for (const char* p = spec + length; ':' == *p; ++num_args) {
+    if (num_args == max_args)
+      return -1;
+    char* end;
+    args[num_args] = strtod(p + 1, &end);
+    if (end == p + 1 || (':' != *end && '\0' != *end))
+      return -1;
+    p = end;
+  }
+  return num_args;
+}
+
+static void parse_dist(const char* option, const char* spec, struct dist* dist) {
+  char name[16];
+  int num_args = split_spec(spec, name, sizeof(name), dist->args, MAX_DIST_ARGS);
+  for (size_t kind = 0; kind < sizeof(dist_kinds) / sizeof(dist_kinds[0]); ++kind) {
+    if (0 == strcmp(name, dist_kinds[kind].name) && num_args == (int)dist_kinds[kind].num_args) {
+      dist->kind = kind;
+      const double* a = dist->args;
+      if (a[0] < 0 ||
+          (DIST_UNIFORM == kind && a[1] < a[0]) ||
+          (DIST_BIMODAL == kind && (a[1] < 0 || a[2] < 0 || a[2] > 1)) ||
+          (DIST_PARETO == kind && (a[0] <= 0 || a[1] <= 0)))
+        bad_argument(option, spec);
+      return;
+    }
+  }
+  bad_argument(option, spec);
+}
+
+static void parse_arrivals(const char* spec, struct config* config) {
+  char name[16];
+  double args[2];
+  int num_args = split_spec(spec, name, sizeof(name), args, 2);
+  if (0 == strcmp(name, "poisson") && 1 == num_args && args[0] >= 0) {
+    config->arrivals = ARRIVALS_POISSON;
+    config->mean_gap = args[0];
+  } else if (0 == strcmp(name, "bursty") && 2 == num_args && args[0] >= 0 && args[1] >= 1) {
+    config->arrivals = ARRIVALS_BURSTY;
+    config->mean_gap = args[0];
+    config->group_size = args[1];
+  } else {
+    bad_argument("arrivals", spec);
+  }
+}
+
+static unsigned long parse_number(const char* option, const char* value, unsigned long min, unsigned long max) {
+  char* end;
+  unsigned long number = strtoul(value, &end, 10);
+  if (end == value || '\0' != *end || '-' == *value || number < min || number > max)
+    bad_argument(option, value);
+  return number;
+}
+
+
+int main(int argc, char** argv) {
+  static const struct option long_options[] = {
+    {"procs", required_argument, NULL, 'n'},
+    {"time-slice", required_argument, NULL, 't'},
+    {"arrivals", required_argument, NULL, 'a'},
+    {"cpu", required_argument, NULL, 'c'},
+    {"io", required_argument, NULL, 'i'},
+    {"cpu-bursts", required_argument, NULL, 'b'},
+    {"tickets", required_argument, NULL, 'k'},
+    {"max-burst", required_argument, NULL, 'm'},
+    {"seed", required_argument, NULL, 's'},
+    {"binary", no_argument, NULL, 'B'},
+    {NULL, 0, NULL, 0}
+  };
+  struct config config = {
+    .num_procs = 1000,
+    .time_slice = 20,
+    .arrivals = ARRIVALS_POISSON,
+    .mean_gap = 10,
+    .group_size = 1,
+    .cpu = {DIST_EXP, {20}},
+    .io = {DIST_EXP, {40}},
+    .tickets = {DIST_UNIFORM, {1, 10}},
+    .mean_cpu_bursts = 3,
+    .max_burst = 1000000,
+    .seed = 1,
+    .binary = 0,
+  };
+
+  int opt;
+  while (-1 != (opt = getopt_long(argc, argv, "", long_options, NULL))) {
+    switch (opt) {
+    case 'n':
+      config.num_procs = parse_number("procs", optarg, 1, INT_MAX);
+      break;
+    case 't':
+      config.time_slice = parse_number("time-slice", optarg, 1, UINT_MAX);
+      break;
+    case 'a':
+      parse_arrivals(optarg, &config);
+      break;
+    case 'c':
+      parse_dist("cpu", optarg, &config.cpu);
+      break;
+    case 'i':
+      parse_dist("io", optarg, &config.io);
+      break;
+    case 'b':
+      config.mean_cpu_bursts = parse_number("cpu-bursts", optarg, 1, UINT_MAX / 2);
+      break;
+    case 'k':
+      parse_dist("tickets", optarg, &config.tickets);
+      break;
+    case 'm':
+      config.max_burst = parse_number("max-burst", optarg, 1, UINT32_MAX);
+      break;
+    case 's':
+      config.seed = parse_number("seed", optarg, 0, ULONG_MAX);
+      break;
+    case 'B':
+      config.binary = 1;
+      break;
+    default:
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (optind + 1 != argc) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  const char* filename = argv[optind];
+  size_t length = strlen(filename);
+  if (length > 6 && 0 == strcmp(filename + length - 6, ".procb"))
+    config.binary = 1;
+
+  FILE* out = (0 == strcmp(filename, "-")) ? stdout : fopen(filename, config.binary ? "wb" : "w");
+  if (NULL == out) {
+    perror("ERROR opening output file");
+    return EXIT_FAILURE;
+  }
+  static char buffer[1 << 20];
+  setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+  unsigned long num_bursts = config.binary ? write_binary(out, &config) : write_text(out, &config);
+  check_write(0 == fclose(out));
+  fprintf(stderr, "%s: %u processes, %lu bursts\n", filename, config.num_procs, num_bursts);
+  return EXIT_SUCCESS;
+}
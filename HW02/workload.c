@@ -0,0 +1,644 @@
+#include "workload.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Files at least this big are split into line-aligned chunks and parsed by
+ * one thread per core: a first pass counts the lines and bursts of each chunk,
+ * which gives every chunk its first pid and first burst slot, and a second
+ * pass parses the chunks in place. */
+#ifndef PARALLEL_PARSE_MIN_BYTES
+#define PARALLEL_PARSE_MIN_BYTES (64UL << 20)
+#endif
+#define MAX_PARSE_THREADS 64
+
+/* what is wrong with a process line, and the token it is wrong at */
+struct parse_error {
+  const char* error; // NULL if nothing is
+  const char* token;
+  int token_length;
+};
+
+struct parse_chunk {
+  const char* start; // first character of the chunk's first line
+  const char* end; // one past the chunk's last line
+  struct workload* workload;
+
+  unsigned long num_lines;
+  unsigned long num_bursts;
+  unsigned long first_pid;
+  unsigned long first_burst;
+
+  // the first parse error in this chunk, if any
+  struct parse_error error;
+  unsigned long error_pid;
+};
+
+
+static int is_blank(char c) {
+  return ' ' == c || '\t' == c || '\r' == c;
+}
+
+
+static int is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+
+/* one past the end of the line starting at p (not including the newline) */
+static const char* line_end(const char* p, const char* end) {
+  const char* newline = memchr(p, '\n', end - p);
+  return (NULL == newline) ? end : newline;
+}
+
+
+/* skips blanks, then returns the length of the token at *p (0 at end of line) */
+static int next_token(const char** p, const char* eol) {
+  while (*p < eol && is_blank(**p))
+    ++*p;
+  const char* token_end = *p;
+  while (token_end < eol && !is_blank(*token_end))
+    ++token_end;
+  return token_end - *p;
+}
+
+
+/* parses a token made only of digits; returns 0 if it has anything else */
+static int parse_number(const char* token, int length, unsigned long* value) {
+  unsigned long result = 0;
+  for (int i = 0; i < length; ++i) {
+    if (!is_digit(token[i]))
+      return 0;
+    result = result * 10 + (token[i] - '0');
+  }
+  *value = result;
+  return 1;
+}
+
+
+/* how many tokens the line from p to eol has */
+static unsigned long count_tokens(const char* p, const char* eol) {
+  unsigned long num_tokens = 0;
+  for (int length = next_token(&p, eol); length > 0; length = next_token(&p, eol)) {
+    ++num_tokens;
+    p += length;
+  }
+  return num_tokens;
+}
+
+
+static void count_chunk(struct parse_chunk* chunk) {
+  for (const char* p = chunk->start; p < chunk->end; ) {
+    const char* eol = line_end(p, chunk->end);
+    unsigned long num_tokens = count_tokens(p, eol);
+    if (num_tokens > 2)
+      chunk->num_bursts += num_tokens - 2;
+    ++chunk->num_lines;
+    p = eol + 1;
+  }
+}
+
+
+static void set_parse_error(struct parse_error* error, const char* message, const char* token, int token_length) {
+  error->error = message;
+  error->token = token;
+  error->token_length = token_length;
+}
+
+
+/* parses the "tickets arrival burst..." line from p to eol into proc (all but
+ * its pid and state), with its bursts in bursts[], which has room for all of
+ * them; returns how many bursts it has, or -1 after filling in error */
+static long parse_process_line(const char* p, const char* eol, struct process* proc, time_ticks_t* bursts,
+                               struct parse_error* error) {
+  unsigned long value;
+  int length = next_token(&p, eol);
+  if (0 == length) {
+    set_parse_error(error, "No number of tickets found on process line", p, 0);
+    return -1;
+  }
+  if (!parse_number(p, length, &value)) {
+    set_parse_error(error, "Failed to convert string to number of tickets", p, length);
+    return -1;
+  }
+  proc->tickets = value;
+  p += length;
+
+  length = next_token(&p, eol);
+  if (0 == length) {
+    set_parse_error(error, "No arrival time found on process line", p, 0);
+    return -1;
+  }
+  if (!parse_number(p, length, &value)) {
+    set_parse_error(error, "Failed to convert string to arrival time", p, length);
+    return -1;
+  }
+  proc->arrival_time = value;
+  p += length;
+
+  // the bursts start with a CPU burst, and then alternate between
+  // CPU and I/O bursts, which their index in bursts[] tells apart
+  long num_bursts = 0;
+  for (length = next_token(&p, eol); length > 0; length = next_token(&p, eol)) {
+    if (!parse_number(p, length, &value)) {
+      set_parse_error(error, "Failed to convert string to burst time", p, length);
+      return -1;
+    }
+    bursts[num_bursts++] = value;
+    p += length;
+  }
+  proc->bursts = bursts;
+  proc->num_bursts = num_bursts;
+  proc->current_burst = 0;
+  return num_bursts;
+}
+
+
+static void parse_chunk(struct parse_chunk* chunk) {
+  struct workload* workload = chunk->workload;
+  unsigned long pid = chunk->first_pid;
+  unsigned long burst_index = chunk->first_burst;
+
+  for (const char* p = chunk->start; p < chunk->end && pid < workload->num_procs; ++pid) {
+    const char* eol = line_end(p, chunk->end);
+    struct process* proc = &workload->procs[pid];
+    proc->pid = pid;
+    proc->state = NOT_ARRIVED;
+    long num_bursts = parse_process_line(p, eol, proc, &workload->bursts[burst_index], &chunk->error);
+    if (num_bursts < 0) {
+      chunk->error_pid = pid;
+      return;
+    }
+    burst_index += num_bursts;
+    p = eol + 1;
+  }
+  chunk->num_bursts = burst_index - chunk->first_burst;
+}
+
+
+static void* count_chunk_thread(void* chunk) {
+  count_chunk(chunk);
+  return NULL;
+}
+
+
+static void* parse_chunk_thread(void* chunk) {
+  parse_chunk(chunk);
+  return NULL;
+}
+
+
+/* runs fn on every item, one thread each when there is more than one item */
+static void run_parallel(void* (*fn)(void*), void* items, size_t item_size, unsigned int num_items) {
+  pthread_t threads[MAX_PARSE_THREADS];
+  int started[MAX_PARSE_THREADS];
+  char* item = items;
+  for (unsigned int i = 1; i < num_items; ++i)
+    started[i] = (0 == pthread_create(&threads[i], NULL, fn, item + i * item_size));
+  fn(item);
+  for (unsigned int i = 1; i < num_items; ++i) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      fn(item + i * item_size); // could not start a thread; do it here instead
+  }
+}
+
+
+/* how many threads to use for a file section of this size */
+static unsigned int parse_threads(size_t bytes) {
+  if (bytes < PARALLEL_PARSE_MIN_BYTES)
+    return 1;
+  long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return (num_cpus < 1) ? 1 : (num_cpus > MAX_PARSE_THREADS) ? MAX_PARSE_THREADS : num_cpus;
+}
+
+
+/* parses a header line: it must start with a number, and the rest is ignored */
+static unsigned long parse_header(const char** p, const char* end, const char* name,
+                                  const char* data, size_t size) {
+  if (*p >= end) {
+    fprintf(stderr, "ERROR reading file: missing %s line\n", name);
+    munmap((void*)data, size);
+    exit(EXIT_FAILURE);
+  }
+  const char* eol = line_end(*p, end);
+  const char* digits_end = *p;
+  while (digits_end < eol && is_digit(*digits_end))
+    ++digits_end;
+  unsigned long value;
+  if (digits_end == *p || !parse_number(*p, digits_end - *p, &value)) {
+    fprintf(stderr, "ERROR in file contents\n");
+    fprintf(stderr, "Failed to convert string \"%.*s\" to %s value\n", (int)(eol - *p), *p, name);
+    munmap((void*)data, size);
+    exit(EXIT_FAILURE);
+  }
+  *p = eol + 1;
+  return value;
+}
+
+
+/* parses a text .proc file that has been mapped at data */
+static void load_text_workload(const char* data, size_t size, struct workload* workload) {
+  const char* end = data + size;
+  const char* p = data;
+  workload->time_slice = parse_header(&p, end, "TIME_SLICE", data, size);
+  workload->num_procs = parse_header(&p, end, "NUM_PROCS", data, size);
+
+  // Split the process lines into chunks that start at the beginning of a line
+  unsigned int num_chunks = parse_threads(end - p);
+  struct parse_chunk chunks[MAX_PARSE_THREADS];
+  memset(chunks, 0, sizeof(chunks));
+  const char* chunk_start = (p < end) ? p : end;
+  for (unsigned int i = 0; i < num_chunks; ++i) {
+    const char* chunk_end = (i + 1 == num_chunks) ? end : chunk_start + (end - chunk_start) / (num_chunks - i);
+    if (chunk_end < end)
+      chunk_end = line_end(chunk_end, end) + 1;
+    if (chunk_end > end)
+      chunk_end = end;
+    chunks[i].start = chunk_start;
+    chunks[i].end = chunk_end;
+    chunks[i].workload = workload;
+    chunk_start = chunk_end;
+  }
+
+  // Pass 1: count lines and bursts, then give every chunk its first pid and burst slot
+  run_parallel(count_chunk_thread, chunks, sizeof(struct parse_chunk), num_chunks);
+  unsigned long total_lines = 0;
+  unsigned long total_bursts = 0;
+  for (unsigned int i = 0; i < num_chunks; ++i) {
+    chunks[i].first_pid = total_lines;
+    chunks[i].first_burst = total_bursts;
+    total_lines += chunks[i].num_lines;
+    total_bursts += chunks[i].num_bursts;
+    chunks[i].num_bursts = 0;
+  }
+  if (total_lines < workload->num_procs) {
+    fprintf(stderr, "ERROR reading file: expected %u process lines but found %lu\n",
+            workload->num_procs, total_lines);
+    munmap((void*)data, size);
+    exit(EXIT_FAILURE);
+  }
+
+  alloc_workload(workload, workload->num_procs, total_bursts);
+  workload->num_bursts = 0; // counted up again as the chunks are parsed
+
+  // Pass 2: parse the lines in place
+  run_parallel(parse_chunk_thread, chunks, sizeof(struct parse_chunk), num_chunks);
+  for (unsigned int i = 0; i < num_chunks; ++i) {
+    if (NULL != chunks[i].error.error) {
+      fprintf(stderr, "ERROR in file contents\n");
+      fprintf(stderr, "%s (process %lu): \"%.*s\"\n", chunks[i].error.error, chunks[i].error_pid,
+              chunks[i].error.token_length, chunks[i].error.token);
+      munmap((void*)data, size);
+      free_workload(workload);
+      exit(EXIT_FAILURE);
+    }
+    workload->num_bursts += chunks[i].num_bursts;
+  }
+
+}
+
+
+struct fill_range {
+  const struct procb_process* table;
+  const uint32_t* bursts;
+  struct workload* workload;
+  unsigned long first_pid;
+  unsigned long end_pid;
+  long bad_pid; // first process whose bursts run past the burst array, or -1
+};
+
+
+static void* fill_range_thread(void* arg) {
+  struct fill_range* range = arg;
+  struct workload* workload = range->workload;
+  range->bad_pid = -1;
+
+  for (unsigned long pid = range->first_pid; pid < range->end_pid; ++pid) {
+    const struct procb_process* entry = &range->table[pid];
+    struct process* proc = &workload->procs[pid];
+    proc->pid = pid;
+    proc->state = NOT_ARRIVED;
+    proc->tickets = entry->tickets;
+    proc->arrival_time = entry->arrival_time;
+    if (entry->first_burst > workload->num_bursts || entry->num_bursts > workload->num_bursts - entry->first_burst) {
+      range->bad_pid = pid;
+      return NULL;
+    }
+
+    // bursts keep their index from the file
+    proc->bursts = &workload->bursts[entry->first_burst];
+    proc->num_bursts = entry->num_bursts;
+    proc->current_burst = 0;
+    memcpy(proc->bursts, &range->bursts[entry->first_burst], entry->num_bursts * sizeof(time_ticks_t));
+  }
+  return NULL;
+}
+
+
+/* loads a binary .procb file that has been mapped at data */
+static void load_binary_workload(const char* data, size_t size, struct workload* workload) {
+  const struct procb_header* header = (const struct procb_header*)data;
+  if (PROCB_VERSION != header->version) {
+    fprintf(stderr, "ERROR in file contents\nUnsupported binary workload version %u (expected %u)\n",
+            header->version, PROCB_VERSION);
+    munmap((void*)data, size);
+    exit(EXIT_FAILURE);
+  }
+  size_t table_size = (size_t)header->num_procs * sizeof(struct procb_process);
+  if (header->num_bursts > (size - sizeof(struct procb_header)) / sizeof(uint32_t) ||
+      sizeof(struct procb_header) + table_size + header->num_bursts * sizeof(uint32_t) > size) {
+    fprintf(stderr, "ERROR reading file: binary workload is truncated\n");
+    munmap((void*)data, size);
+    exit(EXIT_FAILURE);
+  }
+
+  workload->time_slice = header->time_slice;
+  alloc_workload(workload, header->num_procs, header->num_bursts);
+
+  // split the process table into one range per thread
+  struct fill_range ranges[MAX_PARSE_THREADS];
+  unsigned int num_ranges = parse_threads(size);
+  if (num_ranges > workload->num_procs)
+    num_ranges = (0 == workload->num_procs) ? 1 : workload->num_procs;
+  for (unsigned int i = 0; i < num_ranges; ++i) {
+    ranges[i].table = (const struct procb_process*)(data + sizeof(struct procb_header));
+    ranges[i].bursts = (const uint32_t*)(data + sizeof(struct procb_header) + table_size);
+    ranges[i].workload = workload;
+    ranges[i].first_pid = (unsigned long)workload->num_procs * i / num_ranges;
+    ranges[i].end_pid = (unsigned long)workload->num_procs * (i + 1) / num_ranges;
+  }
+  run_parallel(fill_range_thread, ranges, sizeof(struct fill_range), num_ranges);
+
+  for (unsigned int i = 0; i < num_ranges; ++i) {
+    if (-1 != ranges[i].bad_pid) {
+      fprintf(stderr, "ERROR in file contents\nBursts of process %ld run past the end of the burst array\n",
+              ranges[i].bad_pid);
+      munmap((void*)data, size);
+      free_workload(workload);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+
+/* mmaps a workload file for reading front to back, or exits */
+static const char* map_workload(const char* filename, size_t* size) {
+  int fd = open(filename, O_RDONLY);
+  if (-1 == fd) {
+    perror("ERROR opening file");
+    exit(EXIT_FAILURE);
+  }
+  struct stat file_stat;
+  if (-1 == fstat(fd, &file_stat) || 0 == file_stat.st_size) {
+    fprintf(stderr, "ERROR reading file: %s is empty or unreadable\n", filename);
+    close(fd);
+    exit(EXIT_FAILURE);
+  }
+  *size = file_stat.st_size;
+  const char* data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == data) {
+    perror("ERROR mapping file");
+    exit(EXIT_FAILURE);
+  }
+  madvise((void*)data, *size, MADV_SEQUENTIAL);
+  return data;
+}
+
+
+static int is_binary_workload(const char* data, size_t size) {
+  return size >= sizeof(struct procb_header) && 0 == memcmp(data, PROCB_MAGIC, 8);
+}
+
+
+void load_workload(const char* filename, struct workload* workload) {
+  memset(workload, 0, sizeof(struct workload));
+
+  size_t size;
+  const char* data = map_workload(filename, &size);
+  if (is_binary_workload(data, size))
+    load_binary_workload(data, size, workload);
+  else
+    load_text_workload(data, size, workload);
+
+  munmap((void*)data, size);
+}
+
+
+/*************
+ * Streaming *
+ *************/
+
+/* A stream gives the pages it has read back to the kernel every this many
+ * bytes, so what it keeps mapped in stays bounded however big the file is. */
+#define STREAM_RELEASE_BYTES (16UL << 20)
+
+struct workload_stream {
+  const char* data;
+  size_t size;
+  unsigned int num_procs;
+  unsigned long next_pid; // how many processes have been read
+
+  // a text .proc file: the next process line
+  const char* next_line;
+
+  // a binary .procb file
+  const struct procb_process* table;
+  const uint32_t* bursts;
+  uint64_t num_bursts;
+
+  // everything from data up to released has been given back
+  const char* released;
+  const char* released_bursts;
+};
+
+
+/* gives back the whole pages between *released and read_to once there are enough of them */
+static void release_pages(const struct workload_stream* stream, const char** released, const char* read_to) {
+  if (read_to < *released || (size_t)(read_to - *released) < STREAM_RELEASE_BYTES)
+    return;
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  const char* page_end = stream->data + (read_to - stream->data) / page_size * page_size;
+  // the mapping is private and read-only, so anything read again comes back from the file
+  madvise((void*)*released, page_end - *released, MADV_DONTNEED);
+  *released = page_end;
+}
+
+
+struct workload_stream* open_workload_stream(const char* filename, time_ticks_t* time_slice, unsigned int* num_procs) {
+  struct workload_stream* stream = calloc(1, sizeof(struct workload_stream));
+  assert(NULL != stream);
+  stream->data = map_workload(filename, &stream->size);
+  stream->released = stream->data;
+
+  if (is_binary_workload(stream->data, stream->size)) {
+    const struct procb_header* header = (const struct procb_header*)stream->data;
+    size_t table_size = (size_t)header->num_procs * sizeof(struct procb_process);
+    if (PROCB_VERSION != header->version) {
+      fprintf(stderr, "ERROR in file contents\nUnsupported binary workload version %u (expected %u)\n",
+              header->version, PROCB_VERSION);
+      exit(EXIT_FAILURE);
+    }
+    if (header->num_bursts > (stream->size - sizeof(struct procb_header)) / sizeof(uint32_t) ||
+        sizeof(struct procb_header) + table_size + header->num_bursts * sizeof(uint32_t) > stream->size) {
+      fprintf(stderr, "ERROR reading file: binary workload is truncated\n");
+      exit(EXIT_FAILURE);
+    }
+    *time_slice = header->time_slice;
+    stream->num_procs = header->num_procs;
+    stream->num_bursts = header->num_bursts;
+    stream->table = (const struct procb_process*)(stream->data + sizeof(struct procb_header));
+    stream->bursts = (const uint32_t*)(stream->data + sizeof(struct procb_header) + table_size);
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    stream->released_bursts = stream->data + ((const char*)stream->bursts - stream->data) / page_size * page_size;
+  } else {
+    const char* end = stream->data + stream->size;
+    stream->next_line = stream->data;
+    *time_slice = parse_header(&stream->next_line, end, "TIME_SLICE", stream->data, stream->size);
+    stream->num_procs = parse_header(&stream->next_line, end, "NUM_PROCS", stream->data, stream->size);
+  }
+  *num_procs = stream->num_procs;
+  return stream;
+}
+
+
+/* makes sure *bursts has room for num_bursts */
+static void reserve_bursts(time_ticks_t** bursts, unsigned long* capacity, unsigned long num_bursts) {
+  if (num_bursts <= *capacity)
+    return;
+  unsigned long new_capacity = 2 * *capacity;
+  if (new_capacity < num_bursts)
+    new_capacity = num_bursts;
+  free(*bursts); // a process's bursts are only read into here once it has none left
+  *bursts = malloc(new_capacity * sizeof(time_ticks_t));
+  assert(NULL != *bursts);
+  *capacity = new_capacity;
+}
+
+
+void read_workload_process(struct workload_stream* stream, struct process* proc,
+                           time_ticks_t** bursts, unsigned long* capacity) {
+  assert(stream->next_pid < stream->num_procs);
+  unsigned long pid = stream->next_pid++;
+  proc->state = NOT_ARRIVED;
+
+  if (NULL != stream->table) {
+    const struct procb_process* entry = &stream->table[pid];
+    if (entry->first_burst > stream->num_bursts || entry->num_bursts > stream->num_bursts - entry->first_burst) {
+      fprintf(stderr, "ERROR in file contents\nBursts of process %lu run past the end of the burst array\n", pid);
+      exit(EXIT_FAILURE);
+    }
+    proc->tickets = entry->tickets;
+    proc->arrival_time = entry->arrival_time;
+    reserve_bursts(bursts, capacity, entry->num_bursts);
+    memcpy(*bursts, &stream->bursts[entry->first_burst], entry->num_bursts * sizeof(time_ticks_t));
+    proc->bursts = *bursts;
+    proc->num_bursts = entry->num_bursts;
+    proc->current_burst = 0;
+    release_pages(stream, &stream->released, (const char*)entry);
+    release_pages(stream, &stream->released_bursts, (const char*)&stream->bursts[entry->first_burst]);
+    return;
+  }
+
+  const char* end = stream->data + stream->size;
+  if (stream->next_line >= end) {
+    fprintf(stderr, "ERROR reading file: expected %u process lines but found %lu\n", stream->num_procs, pid);
+    exit(EXIT_FAILURE);
+  }
+  const char* eol = line_end(stream->next_line, end);
+  unsigned long num_tokens = count_tokens(stream->next_line, eol);
+  reserve_bursts(bursts, capacity, (num_tokens > 2) ? num_tokens - 2 : 0);
+  struct parse_error error;
+  if (parse_process_line(stream->next_line, eol, proc, *bursts, &error) < 0) {
+    fprintf(stderr, "ERROR in file contents\n");
+    fprintf(stderr, "%s (process %lu): \"%.*s\"\n", error.error, pid, error.token_length, error.token);
+    exit(EXIT_FAILURE);
+  }
+  stream->next_line = eol + 1;
+  release_pages(stream, &stream->released, stream->next_line);
+}
+
+
+void close_workload_stream(struct workload_stream* stream) {
+  if (NULL == stream)
+    return;
+  munmap((void*)stream->data, stream->size);
+  free(stream);
+}
+
+
+void alloc_workload(struct workload* workload, unsigned int num_procs, unsigned long num_bursts) {
+  // sizeof(struct process) keeps the bursts after the processes aligned
+  size_t procs_size = (num_procs + 1UL) * sizeof(struct process);
+  workload->procs = calloc(1, procs_size + (num_bursts + 1) * sizeof(time_ticks_t));
+  assert(NULL != workload->procs);
+  workload->bursts = (time_ticks_t*)((char*)workload->procs + procs_size);
+  workload->num_procs = num_procs;
+  workload->num_bursts = num_bursts;
+}
+
+
+int write_workload_binary(const struct workload* workload, const char* filename) {
+  FILE* file = fopen(filename, "wb");
+  if (NULL == file)
+    return -1;
+  setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+  struct procb_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, PROCB_MAGIC, sizeof(header.magic));
+  header.version = PROCB_VERSION;
+  header.time_slice = workload->time_slice;
+  header.num_procs = workload->num_procs;
+  for (unsigned int pid = 0; pid < workload->num_procs; ++pid)
+    header.num_bursts += BURSTS_LEFT(&workload->procs[pid]);
+  int ok = (1 == fwrite(&header, sizeof(header), 1, file));
+
+  uint64_t first_burst = 0;
+  for (unsigned int pid = 0; ok && pid < workload->num_procs; ++pid) {
+    struct procb_process entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.tickets = workload->procs[pid].tickets;
+    entry.arrival_time = workload->procs[pid].arrival_time;
+    entry.first_burst = first_burst;
+    entry.num_bursts = BURSTS_LEFT(&workload->procs[pid]);
+    first_burst += entry.num_bursts;
+    ok = (1 == fwrite(&entry, sizeof(entry), 1, file));
+  }
+
+  for (unsigned int pid = 0; ok && pid < workload->num_procs; ++pid) {
+    const struct process* proc = &workload->procs[pid];
+    ok = (BURSTS_LEFT(proc) == fwrite(&proc->bursts[proc->current_burst], sizeof(time_ticks_t),
+                                      BURSTS_LEFT(proc), file));
+  }
+
+  if (0 != fclose(file))
+    ok = 0;
+  return ok ? 0 : -1;
+}
+
+
+void copy_workload(struct workload* copy, const struct workload* workload) {
+  *copy = *workload;
+  alloc_workload(copy, workload->num_procs, workload->num_bursts);
+  memcpy(copy->procs, workload->procs, workload->num_procs * sizeof(struct process));
+  memcpy(copy->bursts, workload->bursts, workload->num_bursts * sizeof(time_ticks_t));
+
+  // the processes point into the original's burst array; move them to the copy's
+  for (unsigned int pid = 0; pid < copy->num_procs; ++pid)
+    copy->procs[pid].bursts = copy->bursts + (workload->procs[pid].bursts - workload->bursts);
+}
+
+
+void free_workload(struct workload* workload) {
+  free(workload->procs); // the whole arena
+  memset(workload, 0, sizeof(struct workload));
+}
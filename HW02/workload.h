@@ -0,0 +1,100 @@
+#ifndef _WORKLOAD_H_
+#define _WORKLOAD_H_
+
+#include "process.h"
+#include <stdint.h>
+
+/* A loaded .proc file.  Its processes and all of their bursts come from one
+ * arena, procs[] followed by bursts[], which free_workload() releases at once;
+ * each process's bursts are consecutive in bursts[]. */
+struct workload {
+  time_ticks_t time_slice;
+  unsigned int num_procs;
+  struct process* procs; // array index = pid; the start of the arena
+  time_ticks_t* bursts;
+  unsigned long num_bursts;
+};
+
+/* Binary workload (.procb) layout, in native byte order:
+ *   struct procb_header
+ *   struct procb_process[num_procs] (index = pid)
+ *   uint32_t bursts[num_bursts]      (each process's bursts are consecutive,
+ *                                     starting at its first_burst)
+ */
+#define PROCB_MAGIC "SCHEDPRB"
+#define PROCB_VERSION 1
+
+struct procb_header {
+  char magic[8]; // PROCB_MAGIC, not NUL-terminated
+  uint32_t version;
+  uint32_t time_slice;
+  uint32_t num_procs;
+  uint32_t reserved;
+  uint64_t num_bursts;
+};
+
+struct procb_process {
+  uint32_t tickets;
+  uint32_t arrival_time;
+  uint32_t num_bursts;
+  uint32_t reserved;
+  uint64_t first_burst;
+};
+
+/* load_workload
+ *   mmaps and parses a workload file: either a binary .procb file (detected by
+ *   its magic number) or a text .proc file (the first line holds the time
+ *   slice, the second the number of processes, then one
+ *   "tickets arrival burst..." line per process).  Large files are parsed in
+ *   parallel.  Exits with an error message if the file cannot be read or parsed.
+ */
+void load_workload(const char* filename, struct workload* workload);
+
+/* A workload file read one process at a time, in file order, so that only the
+ * processes being simulated need to be in memory (see sim_stream_file()) */
+struct workload_stream;
+
+/* open_workload_stream
+ *   opens a .proc or .procb file (see load_workload()) to be read a process
+ *   at a time, and sets *time_slice and *num_procs from its header.  Exits
+ *   with an error message if the file cannot be read.
+ */
+struct workload_stream* open_workload_stream(const char* filename, time_ticks_t* time_slice, unsigned int* num_procs);
+
+/* read_workload_process
+ *   reads the next of the stream's num_procs processes into proc (all but its
+ *   pid and cpu), with its bursts in *bursts, an array of *capacity bursts
+ *   that is replaced by a bigger one when they do not fit.  Exits with an
+ *   error message if the process cannot be read or parsed.
+ */
+void read_workload_process(struct workload_stream* stream, struct process* proc,
+                           time_ticks_t** bursts, unsigned long* capacity);
+
+/* close_workload_stream
+ *   releases a stream from open_workload_stream()
+ */
+void close_workload_stream(struct workload_stream* stream);
+
+/* alloc_workload
+ *   allocates the arena for num_procs processes (zeroed) and num_bursts bursts
+ */
+void alloc_workload(struct workload* workload, unsigned int num_procs, unsigned long num_bursts);
+
+/* write_workload_binary
+ *   writes a loaded workload (with all of its bursts still ahead of it) as a
+ *   .procb file; returns 0 on success or -1 on failure (with errno set)
+ */
+int write_workload_binary(const struct workload* workload, const char* filename);
+
+/* copy_workload
+ *   makes copy an independent copy of workload, as it is now, so the same
+ *   workload can be simulated again without reloading it
+ */
+void copy_workload(struct workload* copy, const struct workload* workload);
+
+/* free_workload
+ *   releases the arena of a loaded workload
+ */
+void free_workload(struct workload* workload);
+
+#endif /* _WORKLOAD_H_ */